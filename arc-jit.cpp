@@ -0,0 +1,255 @@
+#include "arc-jit.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#if LLVM_VERSION_MAJOR >= 18
+#include "llvm/TargetParser/Host.h"
+#else
+#include "llvm/Support/Host.h"
+#endif
+#include <chrono>
+#include <iostream>
+
+using namespace llvm;
+
+#if LLVM_VERSION_MAJOR >= 18
+#define OBJECT_FILE_TYPE CodeGenFileType::ObjectFile
+#define AGGRESSIVE_OPT CodeGenOptLevel::Aggressive
+#define ENDS_WITH ends_with
+#else
+#define OBJECT_FILE_TYPE CGFT_ObjectFile
+#define AGGRESSIVE_OPT CodeGenOpt::Aggressive
+#define ENDS_WITH endswith
+#endif
+
+namespace {
+double seconds_since(std::chrono::steady_clock::time_point t_start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       t_start)
+      .count();
+}
+
+/// Hex SHA-256 digest of the concatenation of `parts`.
+std::string hash_parts(ArrayRef<StringRef> parts) {
+  std::string data;
+  for (auto part : parts) {
+    data += part.str();
+    data += '\0';
+  }
+  return toHex(SHA256::hash(arrayRefFromStringRef(data)), true);
+}
+
+/// Write `data` to `path` through a temporary file, such that concurrent runs
+/// never load a partially written file.
+bool write_atomic(const std::string &path, StringRef data) {
+  std::string tmp = path + ".tmp" + std::to_string(sys::Process::getProcessId());
+  std::error_code ec;
+  {
+    raw_fd_ostream os(tmp, ec);
+    if (ec)
+      return false;
+    os << data;
+  }
+  return !sys::fs::rename(tmp, path);
+}
+} // namespace
+
+struct ArcJit::Impl {
+  std::unique_ptr<orc::LLJIT> jit;
+  std::unique_ptr<TargetMachine> target_machine;
+};
+
+ArcJit::ArcJit() : impl(std::make_unique<Impl>()) {}
+ArcJit::~ArcJit() {}
+
+bool ArcJit::load(const std::string &path, std::string &state_file) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  auto t_start = std::chrono::steady_clock::now();
+  if (!cache_dir.empty())
+    sys::fs::create_directories(cache_dir);
+
+  auto input = MemoryBuffer::getFile(path);
+  if (!input) {
+    error = "unable to read model " + path + ": " + input.getError().message();
+    return false;
+  }
+
+  // Lower MLIR inputs to LLVM IR with arcilator, keyed by the input, the
+  // arcilator binary, and its arguments.
+  std::string ir_path = path;
+  if (StringRef(path).ENDS_WITH(".mlir")) {
+    auto arcilator = sys::findProgramByName("arcilator");
+    if (!arcilator) {
+      error = "unable to find `arcilator` to lower " + path;
+      return false;
+    }
+    sys::fs::file_status status;
+    sys::fs::status(*arcilator, status);
+    auto key = hash_parts({(*input)->getBuffer(), *arcilator,
+                           std::to_string(status.getSize()),
+                           std::to_string(status.getLastModificationTime()
+                                              .time_since_epoch()
+                                              .count()),
+                           arcilator_args});
+    auto dir = cache_dir.empty() ? sys::path::parent_path(path).str()
+                                 : cache_dir;
+    SmallString<128> base(dir);
+    sys::path::append(base, cache_dir.empty()
+                                ? sys::path::stem(path).str() + "-jit"
+                                : key);
+    ir_path = (base + ".ll").str();
+    auto arc_state_file = (base + ".json").str();
+    if (cache_dir.empty() || !sys::fs::exists(ir_path) ||
+        !sys::fs::exists(arc_state_file)) {
+      std::string state_arg = "--state-file=" + arc_state_file;
+      SmallVector<StringRef> args = {*arcilator, path, state_arg, "-o",
+                                     ir_path};
+      SmallVector<StringRef> extra_args;
+      StringRef(arcilator_args).split(extra_args, ' ', -1, false);
+      args.append(extra_args.begin(), extra_args.end());
+      if (verbose)
+        std::cerr << "jit: lowering " << path << " with arcilator\n";
+      std::string message;
+      if (sys::ExecuteAndWait(*arcilator, args, {}, {}, 0, 0, &message) != 0) {
+        sys::fs::remove(ir_path);
+        error = "arcilator failed to lower " + path +
+                (message.empty() ? "" : ": " + message);
+        return false;
+      }
+    }
+    if (state_file.empty())
+      state_file = arc_state_file;
+    input = MemoryBuffer::getFile(ir_path);
+    if (!input) {
+      error = "unable to read " + ir_path + ": " + input.getError().message();
+      return false;
+    }
+  }
+
+  // Set up the JIT for the host, with the same target machine used to compile
+  // the model, such that cached objects match the host they are loaded on.
+  auto jtmb = orc::JITTargetMachineBuilder::detectHost();
+  if (!jtmb) {
+    error = toString(jtmb.takeError());
+    return false;
+  }
+  jtmb->setCodeGenOptLevel(AGGRESSIVE_OPT);
+  auto target_machine = jtmb->createTargetMachine();
+  if (!target_machine) {
+    error = toString(target_machine.takeError());
+    return false;
+  }
+  impl->target_machine = std::move(*target_machine);
+  auto &tm = *impl->target_machine;
+  auto jit = orc::LLJITBuilder().setJITTargetMachineBuilder(*jtmb).create();
+  if (!jit) {
+    error = toString(jit.takeError());
+    return false;
+  }
+  impl->jit = std::move(*jit);
+  impl->jit->getMainJITDylib().addGenerator(
+      cantFail(orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          impl->jit->getDataLayout().getGlobalPrefix())));
+
+  // Look for a cached object of the model before compiling it.
+  auto key = hash_parts({(*input)->getBuffer(), LLVM_VERSION_STRING,
+                         tm.getTargetTriple().str(), tm.getTargetCPU(),
+                         tm.getTargetFeatureString(), "O3"});
+  SmallString<128> object_path(cache_dir);
+  sys::path::append(object_path, key + ".o");
+  std::unique_ptr<MemoryBuffer> object;
+  if (!cache_dir.empty()) {
+    if (auto cached = MemoryBuffer::getFile(object_path)) {
+      object = std::move(*cached);
+      if (verbose)
+        std::cerr << "jit: loading cached " << object_path.str().str()
+                  << "\n";
+    }
+  }
+
+  if (!object) {
+    if (verbose)
+      std::cerr << "jit: compiling " << ir_path << " for "
+                << tm.getTargetCPU().str() << "\n";
+    LLVMContext context;
+    SMDiagnostic diag;
+    auto module = parseIR((*input)->getMemBufferRef(), diag, context);
+    if (!module) {
+      std::string message;
+      raw_string_ostream os(message);
+      diag.print("arc-jit", os);
+      error = os.str();
+      return false;
+    }
+    module->setDataLayout(tm.createDataLayout());
+    module->setTargetTriple(tm.getTargetTriple().str());
+
+    // Optimize like the offline `opt -O3` build.
+    LoopAnalysisManager lam;
+    FunctionAnalysisManager fam;
+    CGSCCAnalysisManager cgam;
+    ModuleAnalysisManager mam;
+    PassBuilder pb(&tm);
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+    pb.buildPerModuleDefaultPipeline(OptimizationLevel::O3).run(*module, mam);
+
+    // Generate the object, like the offline `llc -O3`.
+    SmallVector<char, 0> buffer;
+    raw_svector_ostream os(buffer);
+    legacy::PassManager codegen;
+    if (tm.addPassesToEmitFile(codegen, os, nullptr, OBJECT_FILE_TYPE)) {
+      error = "unable to emit an object for " + tm.getTargetTriple().str();
+      return false;
+    }
+    codegen.run(*module);
+    StringRef data(buffer.data(), buffer.size());
+    if (!cache_dir.empty() && !write_atomic(object_path.str().str(), data))
+      std::cerr << "jit: unable to cache " << object_path.str().str() << "\n";
+    object = MemoryBuffer::getMemBufferCopy(data, path);
+  }
+
+  if (auto err = impl->jit->addObjectFile(std::move(object))) {
+    error = toString(std::move(err));
+    return false;
+  }
+  if (verbose)
+    std::cerr << "jit: model ready after " << seconds_since(t_start) << " s\n";
+  return true;
+}
+
+void *ArcJit::lookup(const std::string &symbol) {
+  if (!impl->jit)
+    return nullptr;
+  auto address = impl->jit->lookup(symbol);
+  if (!address) {
+    consumeError(address.takeError());
+    return nullptr;
+  }
+#if LLVM_VERSION_MAJOR >= 15
+  return address->toPtr<void *>();
+#else
+  return reinterpret_cast<void *>(address->getAddress());
+#endif
+}
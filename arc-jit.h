@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+/// Compiles an Arcilator model at runtime and loads it into the process
+/// through the LLVM ORC JIT, instead of linking an object built offline by
+/// `opt` and `llc`. Compiled objects are cached on disk keyed by a hash of the
+/// model and the host target, such that later runs of an unchanged model only
+/// load the cached object.
+class ArcJit {
+public:
+  ArcJit();
+  ~ArcJit();
+
+  /// Load the model in `path`, either the LLVM IR produced by arcilator
+  /// (`.ll` or `.bc`) or the HW dialect MLIR it consumes (`.mlir`). MLIR is
+  /// lowered by running `arcilator` first, which also writes the state file;
+  /// its path is stored in `state_file` unless one is already given. Returns
+  /// false and sets `error` on failure.
+  bool load(const std::string &path, std::string &state_file);
+
+  /// Address of a symbol of the loaded model, or null if there is none.
+  void *lookup(const std::string &symbol);
+
+  /// Directory holding the cached objects, and the LLVM IR and state files
+  /// produced from MLIR inputs. Caching is disabled if empty.
+  std::string cache_dir;
+  /// Arguments for `arcilator` when lowering MLIR inputs.
+  std::string arcilator_args =
+      "--observe-wires=0 --observe-ports=0 --observe-named-values=0 "
+      "--observe-registers=0 --observe-memories=0";
+  /// Print what is compiled and loaded, and how long it takes.
+  bool verbose = false;
+  std::string error;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl;
+};
@@ -0,0 +1,310 @@
+#include "arc-state.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+/// A parsed JSON value. Only what is needed to read state files.
+struct JsonValue {
+  enum Kind { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } kind = NUL;
+  bool boolean = false;
+  uint64_t number = 0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+
+  const JsonValue *get(std::string_view key) const {
+    for (auto &[k, v] : object)
+      if (k == key)
+        return &v;
+    return nullptr;
+  }
+};
+
+/// Minimal recursive descent JSON parser.
+class JsonParser {
+public:
+  JsonParser(std::string_view text) : text(text) {}
+
+  bool parse(JsonValue &value) {
+    if (!parse_value(value))
+      return false;
+    skip_space();
+    if (pos != text.size())
+      return fail("trailing characters");
+    return true;
+  }
+
+  std::string error;
+
+private:
+  std::string_view text;
+  size_t pos = 0;
+
+  bool fail(const char *msg) {
+    error = std::string(msg) + " at offset " + std::to_string(pos);
+    return false;
+  }
+
+  void skip_space() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                 text[pos] == '\r' || text[pos] == '\t'))
+      ++pos;
+  }
+
+  bool consume(char c) {
+    skip_space();
+    if (pos < text.size() && text[pos] == c) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume_word(std::string_view word) {
+    if (text.substr(pos, word.size()) != word)
+      return false;
+    pos += word.size();
+    return true;
+  }
+
+  bool parse_value(JsonValue &value) {
+    skip_space();
+    if (pos == text.size())
+      return fail("unexpected end of input");
+    char c = text[pos];
+    if (c == '{')
+      return parse_object(value);
+    if (c == '[')
+      return parse_array(value);
+    if (c == '"') {
+      value.kind = JsonValue::STRING;
+      return parse_string(value.string);
+    }
+    if (c == '-' || (c >= '0' && c <= '9'))
+      return parse_number(value);
+    if (consume_word("true")) {
+      value.kind = JsonValue::BOOL;
+      value.boolean = true;
+      return true;
+    }
+    if (consume_word("false")) {
+      value.kind = JsonValue::BOOL;
+      return true;
+    }
+    if (consume_word("null"))
+      return true;
+    return fail("unexpected character");
+  }
+
+  bool parse_object(JsonValue &value) {
+    value.kind = JsonValue::OBJECT;
+    ++pos;
+    if (consume('}'))
+      return true;
+    do {
+      std::string key;
+      skip_space();
+      if (pos == text.size() || text[pos] != '"')
+        return fail("expected object key");
+      if (!parse_string(key))
+        return false;
+      if (!consume(':'))
+        return fail("expected `:`");
+      value.object.emplace_back(std::move(key), JsonValue());
+      if (!parse_value(value.object.back().second))
+        return false;
+    } while (consume(','));
+    if (!consume('}'))
+      return fail("expected `}`");
+    return true;
+  }
+
+  bool parse_array(JsonValue &value) {
+    value.kind = JsonValue::ARRAY;
+    ++pos;
+    if (consume(']'))
+      return true;
+    do {
+      value.array.emplace_back();
+      if (!parse_value(value.array.back()))
+        return false;
+    } while (consume(','));
+    if (!consume(']'))
+      return fail("expected `]`");
+    return true;
+  }
+
+  bool parse_string(std::string &out) {
+    ++pos;
+    while (pos < text.size() && text[pos] != '"') {
+      char c = text[pos++];
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos == text.size())
+        break;
+      c = text[pos++];
+      switch (c) {
+      case 'n':
+        out += '\n';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'u':
+        // State names are plain ASCII; keep escaped code points verbatim.
+        out += "\\u";
+        break;
+      default:
+        out += c;
+        break;
+      }
+    }
+    if (pos == text.size())
+      return fail("unterminated string");
+    ++pos;
+    return true;
+  }
+
+  bool parse_number(JsonValue &value) {
+    value.kind = JsonValue::NUMBER;
+    size_t start = pos;
+    if (text[pos] == '-')
+      ++pos;
+    while (pos < text.size() &&
+           ((text[pos] >= '0' && text[pos] <= '9') || text[pos] == '.' ||
+            text[pos] == 'e' || text[pos] == 'E' || text[pos] == '+' ||
+            text[pos] == '-'))
+      ++pos;
+    std::string digits(text.substr(start, pos - start));
+    value.number = std::strtoull(digits.c_str(), nullptr, 10);
+    return true;
+  }
+};
+
+/// Canonicalize a user-provided path to the `/`-separated form used in the
+/// state file.
+std::string canonicalize(std::string_view path) {
+  std::string result(path);
+  for (auto &c : result)
+    if (c == '.')
+      c = '/';
+  if (result.rfind("internal/", 0) == 0)
+    result.erase(0, 9);
+  return result;
+}
+} // namespace
+
+bool StateFile::load(const std::string &path, const std::string &model) {
+  std::ifstream file(path);
+  if (!file) {
+    error = "unable to open state file " + path;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string text = buffer.str();
+
+  JsonValue root;
+  JsonParser parser(text);
+  if (!parser.parse(root)) {
+    error = path + ": " + parser.error;
+    return false;
+  }
+  if (root.kind != JsonValue::ARRAY) {
+    error = path + ": expected array of models";
+    return false;
+  }
+
+  const JsonValue *model_value = nullptr;
+  for (auto &m : root.array) {
+    auto *name = m.get("name");
+    if (model.empty() || (name && name->string == model)) {
+      model_value = &m;
+      break;
+    }
+  }
+  if (!model_value) {
+    error = path + ": no model " + (model.empty() ? "" : "`" + model + "` ") +
+            "in state file";
+    return false;
+  }
+
+  if (auto *name = model_value->get("name"))
+    model_name = name->string;
+  if (auto *num_bytes = model_value->get("numStateBytes"))
+    num_state_bytes = num_bytes->number;
+  if (auto *initial = model_value->get("initialFnSym"))
+    initial_fn_sym = initial->string;
+
+  all_states.clear();
+  index.clear();
+  if (auto *states = model_value->get("states")) {
+    for (auto &s : states->array) {
+      StateInfo info;
+      if (auto *v = s.get("name"))
+        info.name = v->string;
+      if (auto *v = s.get("offset"))
+        info.offset = v->number;
+      if (auto *v = s.get("numBits"))
+        info.num_bits = v->number;
+      if (auto *v = s.get("stride"))
+        info.stride = v->number;
+      if (auto *v = s.get("depth"))
+        info.depth = v->number;
+      if (auto *v = s.get("type")) {
+        if (v->string == "input")
+          info.type = StateInfo::INPUT;
+        else if (v->string == "output")
+          info.type = StateInfo::OUTPUT;
+        else if (v->string == "register")
+          info.type = StateInfo::REGISTER;
+        else if (v->string == "memory")
+          info.type = StateInfo::MEMORY;
+        else
+          info.type = StateInfo::WIRE;
+      }
+      all_states.push_back(std::move(info));
+    }
+  }
+  for (size_t i = 0; i < all_states.size(); ++i)
+    index.emplace(all_states[i].name, i);
+  return true;
+}
+
+const StateInfo *StateFile::find(std::string_view path) const {
+  auto it = index.find(std::string(path));
+  if (it == index.end())
+    it = index.find(canonicalize(path));
+  if (it == index.end())
+    return nullptr;
+  return &all_states[it->second];
+}
+
+std::vector<const StateInfo *>
+StateFile::find_suffix(std::string_view suffix) const {
+  auto canonical = canonicalize(suffix);
+  std::vector<const StateInfo *> result;
+  for (auto &state : all_states) {
+    auto &name = state.name;
+    if (name.size() < canonical.size() ||
+        name.compare(name.size() - canonical.size(), canonical.size(),
+                     canonical) != 0)
+      continue;
+    if (name.size() == canonical.size() ||
+        name[name.size() - canonical.size() - 1] == '/')
+      result.push_back(&state);
+  }
+  return result;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// A single state of an Arcilator model, as described by the JSON state file
+/// produced by `arcilator --state-file`.
+struct StateInfo {
+  enum Type { INPUT, OUTPUT, REGISTER, MEMORY, WIRE };
+
+  std::string name;
+  Type type = WIRE;
+  /// Byte offset of the state within the model storage.
+  size_t offset = 0;
+  /// Bit width of the state, or of a single word for memories.
+  unsigned num_bits = 0;
+  /// Number of bytes between consecutive words of a memory.
+  size_t stride = 0;
+  /// Number of words in a memory.
+  size_t depth = 0;
+
+  size_t num_bytes() const { return (num_bits + 7) / 8; }
+};
+
+/// Index over the states of a model in an Arcilator state file, hashed by
+/// hierarchical name. Names use `/` as hierarchy separator as in the state
+/// file; lookups also accept `.` and an optional leading `internal`, such that
+/// paths can be copied from the C++ view generated by
+/// `arcilator-header-cpp.py`.
+class StateFile {
+public:
+  /// Load the model called `model` from the state file at `path`, or the first
+  /// model in the file if `model` is empty. Returns false and sets `error` if
+  /// the file cannot be read or parsed.
+  bool load(const std::string &path, const std::string &model = "");
+
+  /// Look up a state by its hierarchical name. Returns null if there is no
+  /// such state.
+  const StateInfo *find(std::string_view path) const;
+
+  /// Find all states whose name ends in the hierarchical name `suffix`,
+  /// matching at hierarchy boundaries only.
+  std::vector<const StateInfo *> find_suffix(std::string_view suffix) const;
+
+  const std::vector<StateInfo> &states() const { return all_states; }
+
+  std::string model_name;
+  size_t num_state_bytes = 0;
+  /// Symbol of the function that initializes the model storage, if any.
+  std::string initial_fn_sym;
+  std::string error;
+
+private:
+  std::vector<StateInfo> all_states;
+  std::unordered_map<std::string, size_t> index;
+};
+
+/// Typed access to a single state within the storage of a model instance.
+/// Resolve a reference once through `StateFile::find` and then peek and poke
+/// it in the simulation loop without further lookups.
+class StateRef {
+public:
+  StateRef() {}
+  StateRef(uint8_t *storage, const StateInfo *info)
+      : storage(storage), info(info) {}
+
+  explicit operator bool() const { return storage && info; }
+  const StateInfo &state() const { return *info; }
+
+  /// Address of the state, or of word `index` of a memory.
+  uint8_t *address(size_t index = 0) const {
+    return storage + info->offset + index * info->stride;
+  }
+
+  /// Read the state, truncated to `T`.
+  template <typename T = uint64_t>
+  T peek(size_t index = 0) const {
+    T value = 0;
+    std::memcpy(&value, address(index), std::min(sizeof(T), info->num_bytes()));
+    if (info->num_bits < sizeof(T) * 8)
+      value &= (T(1) << info->num_bits) - 1;
+    return value;
+  }
+
+  /// Write the state. Bits beyond the width of the state are discarded.
+  template <typename T = uint64_t>
+  void poke(T value, size_t index = 0) const {
+    if (info->num_bits < sizeof(T) * 8)
+      value &= (T(1) << info->num_bits) - 1;
+    std::memcpy(address(index), &value, std::min(sizeof(T), info->num_bytes()));
+  }
+
+  /// Copy states of arbitrary width from and to a little-endian buffer of
+  /// `state().num_bytes()` bytes.
+  void peek_bytes(void *data, size_t index = 0) const {
+    std::memcpy(data, address(index), info->num_bytes());
+  }
+  void poke_bytes(const void *data, size_t index = 0) const {
+    std::memcpy(address(index), data, info->num_bytes());
+  }
+
+private:
+  uint8_t *storage = nullptr;
+  const StateInfo *info = nullptr;
+};
@@ -0,0 +1,21 @@
+// See LICENSE for license details.
+
+#ifndef __MAILBOX_H
+#define __MAILBOX_H
+
+// Number of harts the runtime brings up. Additional harts park in crt.S.
+#ifndef NUM_HARTS
+#define NUM_HARTS 1
+#endif
+
+// Every hart communicates with the host through its own mailbox in the
+// .tohost section. Hart N's mailbox starts MAILBOX_SIZE * N bytes after hart
+// 0's and is laid out as follows:
+//
+//   0x00  tohost
+//   0x40  fromhost
+//   0x80  tohost_data (TOHOST_DATA_SIZE bytes)
+//   0xC0  tohost_stats (mcycle and minstret at exit)
+#define MAILBOX_SIZE 0x100
+
+#endif //__MAILBOX_H
@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <sys/signal.h>
 #include "util.h"
+#include "mailbox.h"
 
 #define SYS_write 64
 #define TOHOST_DATA_SIZE 64
@@ -16,22 +17,42 @@
 extern volatile uint64_t tohost;
 extern volatile uint64_t fromhost;
 extern volatile uint8_t tohost_data;
+extern volatile uint64_t tohost_stats;
+
+// Locate a mailbox field of the current hart, given the field of hart 0.
+#define MAILBOX(field) \
+  (*(__typeof__(field)*)((uintptr_t)&(field) + read_csr(mhartid) * MAILBOX_SIZE))
 
 static uintptr_t syscall(uintptr_t which, uint64_t arg0, uint64_t arg1, uint64_t arg2)
 {
   if (which == SYS_write) {
     // Move data to the MMIO mapped region, cut off the data if it does not fit
-    // into the pre-allocated space.
-    // Don't use memcpy to make sure the write mask is always 0xFF.
-    for (int i = 0; i < arg2 && i < TOHOST_DATA_SIZE; i+=8)
-      *(uint64_t*)(&tohost_data+i) = *(uint64_t*)(arg1+i);
+    // into the pre-allocated space. The host prints up to the first zero byte.
+    // Copy whole words, such that every store is a single full-width AXI beat,
+    // and zero-pad the last one instead of reading past the end of the buffer.
+    // A zero byte terminates word-aligned data, which the host merges into the
+    // mailbox through the write strobe.
+    volatile uint64_t* data = (volatile uint64_t*)&MAILBOX(tohost_data);
+    const uint8_t* src = (const uint8_t*)arg1;
+    uint64_t len = arg2 < TOHOST_DATA_SIZE ? arg2 : TOHOST_DATA_SIZE;
+    uint64_t i;
+    for (i = 0; i + 8 <= len; i += 8)
+      data[i / 8] = *(const uint64_t*)(src + i);
+    if (i < len) {
+      uint64_t tail = 0;
+      for (int j = 0; i + j < len; j++)
+        tail |= (uint64_t)src[i + j] << (j * 8);
+      data[i / 8] = tail;
+    } else if (i < TOHOST_DATA_SIZE) {
+      ((volatile uint8_t*)data)[i] = 0;
+    }
   }
   __sync_synchronize();
 
-  tohost = which;
-  while (fromhost == 0)
+  MAILBOX(tohost) = which;
+  while (MAILBOX(fromhost) == 0)
     ;
-  fromhost = 0;
+  MAILBOX(fromhost) = 0;
 
   __sync_synchronize();
   return 0; // incorrect return code, but nobody cares anyway
@@ -59,7 +80,13 @@ void setStats(int enable)
 
 void __attribute__((noreturn)) tohost_exit(uintptr_t code)
 {
-  tohost = (code << 1) | 1;
+  // Leave the hart's counters for the host to report.
+  volatile uint64_t* stats = &MAILBOX(tohost_stats);
+  stats[0] = read_csr(mcycle);
+  stats[1] = read_csr(minstret);
+  __sync_synchronize();
+
+  MAILBOX(tohost) = (code << 1) | 1;
   while (1);
 }
 
@@ -86,8 +113,10 @@ void printstr(const char* s)
 void __attribute__((weak)) thread_entry(int cid, int nc)
 {
   // multi-threaded programs override this function.
-  // for the case of single-threaded programs, only let core 0 proceed.
-  while (cid != 0);
+  // for the case of single-threaded programs, only let core 0 proceed and
+  // have the other cores report completion right away.
+  if (cid != 0)
+    exit(0);
 }
 
 int __attribute__((weak)) main(int argc, char** argv)
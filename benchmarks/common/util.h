@@ -77,6 +77,10 @@ static void __attribute__((noinline)) barrier(int ncores)
   __sync_synchronize();
 }
 
+// Starting state for lfsr(). Starting from 1 instead shifts a single bit down
+// for the first ~60 steps, yielding powers of two.
+#define LFSR_SEED 0x2545F4914F6CDD1DULL
+
 static uint64_t lfsr(uint64_t x)
 {
   uint64_t bit = (x ^ (x >> 1)) & 1;
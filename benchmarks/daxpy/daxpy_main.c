@@ -0,0 +1,49 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Double precision a*x+y benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark computes y = a*x + y on vectors of SIZE doubles, ROUNDS
+// times over. Inputs are small integers, such that every intermediate result
+// is exact and the final vector equals y + ROUNDS*a*x. Set SIZE at compile
+// time to scale the run.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 8192
+#endif
+#define ROUNDS 4
+
+double input_x[SIZE];
+double results_data[SIZE];
+double verify_data[SIZE];
+
+static void daxpy(int n, double a, const double* x, double* y)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    y[i] = a * x[i] + y[i];
+}
+
+int main(int argc, char* argv[])
+{
+  const double a = 3;
+  int i, r;
+  for (i = 0; i < SIZE; i++)
+  {
+    input_x[i] = i % 64 - 32;
+    results_data[i] = i % 7;
+    verify_data[i] = results_data[i] + ROUNDS * a * input_x[i];
+  }
+
+  // Do the computation
+  setStats(1);
+  for (r = 0; r < ROUNDS; r++)
+    daxpy(SIZE, a, input_x, results_data);
+  setStats(0);
+
+  // Check the results
+  return verifyDouble(SIZE, results_data, verify_data);
+}
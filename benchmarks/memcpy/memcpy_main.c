@@ -0,0 +1,39 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Memcpy benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark copies SIZE bytes of pseudo-random data with the memcpy()
+// from syscalls.c and checks the copy against the source. Set SIZE at
+// compile time to scale the run; it should be a multiple of 8.
+
+#include <string.h>
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 65536
+#endif
+#define NUM_WORDS (SIZE / sizeof(int))
+
+int input_data[NUM_WORDS] __attribute__((aligned(64)));
+int results_data[NUM_WORDS] __attribute__((aligned(64)));
+
+int main(int argc, char* argv[])
+{
+  uint64_t x = 1;
+  int i;
+  for (i = 0; i < NUM_WORDS; i++)
+  {
+    x = lfsr(x);
+    input_data[i] = x;
+  }
+
+  // Do the copy
+  setStats(1);
+  memcpy(results_data, input_data, sizeof(input_data));
+  setStats(0);
+
+  // Check the results
+  return verify(NUM_WORDS, results_data, input_data);
+}
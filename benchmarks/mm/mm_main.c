@@ -0,0 +1,65 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Matrix multiply benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark multiplies two SIZE x SIZE integer matrices. The inputs are
+// chosen as A[i][k] = i + k and B[k][j] = k - j, such that every element of
+// the product has a closed form and the result can be checked without a
+// second multiplication. Set SIZE at compile time to scale the run; products
+// stay within an int up to a SIZE of about 1000.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 64
+#endif
+
+int input1_data[SIZE][SIZE];
+int input2_data[SIZE][SIZE];
+int results_data[SIZE][SIZE];
+int verify_data[SIZE][SIZE];
+
+static void matmul(int n, int a[SIZE][SIZE], int b[SIZE][SIZE],
+                   int c[SIZE][SIZE])
+{
+  int i, j, k;
+  for (i = 0; i < n; i++)
+  {
+    for (j = 0; j < n; j++)
+      c[i][j] = 0;
+    for (k = 0; k < n; k++)
+    {
+      int aik = a[i][k];
+      for (j = 0; j < n; j++)
+        c[i][j] += aik * b[k][j];
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int i, j;
+  for (i = 0; i < SIZE; i++)
+    for (j = 0; j < SIZE; j++)
+    {
+      input1_data[i][j] = i + j;
+      input2_data[i][j] = i - j;
+    }
+
+  // Do the multiply
+  setStats(1);
+  matmul(SIZE, input1_data, input2_data, results_data);
+  setStats(0);
+
+  // C[i][j] = sum_k (i + k)(k - j) = (i - j) S1 - n i j + S2
+  long s1 = (long)SIZE * (SIZE - 1) / 2;
+  long s2 = (long)(SIZE - 1) * SIZE * (2 * SIZE - 1) / 6;
+  for (i = 0; i < SIZE; i++)
+    for (j = 0; j < SIZE; j++)
+      verify_data[i][j] = (i - j) * s1 - (long)SIZE * i * j + s2;
+
+  // Check the results
+  return verify(SIZE * SIZE, &results_data[0][0], &verify_data[0][0]);
+}
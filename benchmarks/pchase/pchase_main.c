@@ -0,0 +1,81 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Pointer chasing benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark walks a circular linked list of SIZE nodes ROUNDS times.
+// The nodes are linked in a pseudo-random order and padded to a cache line,
+// such that every hop is a dependent load that misses once the list outgrows
+// the data cache. Each round sums the node values, which is checked against
+// the sum of 0 to SIZE-1. Set SIZE at compile time to scale the run.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 4096
+#endif
+#define ROUNDS 4
+
+struct Node
+{
+  struct Node* next;
+  unsigned value;
+} __attribute__((aligned(64)));
+
+struct Node nodes[SIZE];
+int order[SIZE];
+int results_data[ROUNDS];
+int verify_data[ROUNDS];
+
+static struct Node* chase(struct Node* node, int num_hops, unsigned* sum)
+{
+  unsigned s = 0;
+  int i;
+  for (i = 0; i < num_hops; i++)
+  {
+    s += node->value;
+    node = node->next;
+  }
+  *sum = s;
+  return node;
+}
+
+int main(int argc, char* argv[])
+{
+  uint64_t x = LFSR_SEED;
+  int i, r;
+  for (i = 0; i < SIZE; i++)
+    order[i] = i;
+  for (i = SIZE - 1; i > 0; i--)
+  {
+    x = lfsr(x);
+    int j = x % (i + 1);
+    int t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (i = 0; i < SIZE; i++)
+  {
+    nodes[order[i]].next = &nodes[order[(i + 1) % SIZE]];
+    nodes[order[i]].value = order[i];
+  }
+
+  // Walk the list
+  struct Node* node = &nodes[order[0]];
+  setStats(1);
+  for (r = 0; r < ROUNDS; r++)
+  {
+    unsigned sum;
+    node = chase(node, SIZE, &sum);
+    results_data[r] = sum;
+  }
+  setStats(0);
+
+  // Check the results
+  for (r = 0; r < ROUNDS; r++)
+    verify_data[r] = (unsigned)((uint64_t)SIZE * (SIZE - 1) / 2);
+  if (node != &nodes[order[0]])
+    return ROUNDS + 1;
+  return verify(ROUNDS, results_data, verify_data);
+}
@@ -0,0 +1,119 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Quicksort benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark sorts SIZE integers with an iterative quicksort, using a
+// median-of-three pivot and insertion sort for short ranges. The input is a
+// pseudo-random permutation of 0 to SIZE-1, such that the sorted array can be
+// checked against the identity. Set SIZE at compile time to scale the run.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 2048
+#endif
+
+#define INSERTION_THRESHOLD 10
+#define NSTACK 128
+
+int input_data[SIZE];
+int verify_data[SIZE];
+
+static inline void swap(int* a, int* b)
+{
+  int t = *a;
+  *a = *b;
+  *b = t;
+}
+
+static void insertion_sort(int n, int* a)
+{
+  int i, j;
+  for (i = 1; i < n; i++)
+  {
+    int v = a[i];
+    for (j = i; j > 0 && a[j-1] > v; j--)
+      a[j] = a[j-1];
+    a[j] = v;
+  }
+}
+
+static void sort(int n, int* a)
+{
+  int stack[NSTACK];
+  int sp = 0;
+  int lo = 0, hi = n - 1;
+
+  while (1)
+  {
+    if (hi - lo < INSERTION_THRESHOLD)
+    {
+      insertion_sort(hi - lo + 1, a + lo);
+      if (sp == 0)
+        break;
+      hi = stack[--sp];
+      lo = stack[--sp];
+      continue;
+    }
+
+    // Order a[lo], a[mid], a[hi] and partition around the median.
+    int mid = lo + (hi - lo) / 2;
+    if (a[mid] < a[lo]) swap(&a[mid], &a[lo]);
+    if (a[hi] < a[lo]) swap(&a[hi], &a[lo]);
+    if (a[hi] < a[mid]) swap(&a[hi], &a[mid]);
+    int pivot = a[mid];
+    int i = lo, j = hi;
+    while (i <= j)
+    {
+      while (a[i] < pivot) i++;
+      while (a[j] > pivot) j--;
+      if (i <= j)
+      {
+        swap(&a[i], &a[j]);
+        i++;
+        j--;
+      }
+    }
+
+    // Push the larger partition and continue with the smaller one, which
+    // bounds the stack depth to log2(n).
+    if (j - lo > hi - i)
+    {
+      stack[sp++] = lo;
+      stack[sp++] = j;
+      lo = i;
+    }
+    else
+    {
+      stack[sp++] = i;
+      stack[sp++] = hi;
+      hi = j;
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  uint64_t x = LFSR_SEED;
+  int i;
+  for (i = 0; i < SIZE; i++)
+  {
+    input_data[i] = i;
+    verify_data[i] = i;
+  }
+  for (i = SIZE - 1; i > 0; i--)
+  {
+    x = lfsr(x);
+    swap(&input_data[i], &input_data[x % (i + 1)]);
+  }
+
+  // Do the sort
+  setStats(1);
+  sort(SIZE, input_data);
+  setStats(0);
+
+  // Check the results
+  return verify(SIZE, input_data, verify_data);
+}
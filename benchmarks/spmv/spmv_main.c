@@ -0,0 +1,69 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Sparse matrix-vector multiply benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark multiplies a SIZE x SIZE sparse matrix in compressed sparse
+// row format with a dense vector. Every row holds NNZ_PER_ROW nonzeros at
+// pseudo-random columns. Matrix and vector hold small integers, such that
+// the double precision sums are exact; the expected result is accumulated
+// while generating the matrix. Set SIZE at compile time to scale the run.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 4096
+#endif
+#define NNZ_PER_ROW 8
+#define NNZ (SIZE * NNZ_PER_ROW)
+
+double val[NNZ];
+int idx[NNZ];
+int ptr[SIZE + 1];
+double x[SIZE];
+double results_data[SIZE];
+double verify_data[SIZE];
+
+static void spmv(int r, const double* val, const int* idx, const double* x,
+                 const int* ptr, double* y)
+{
+  int i, k;
+  for (i = 0; i < r; i++)
+  {
+    double yi = 0;
+    for (k = ptr[i]; k < ptr[i+1]; k++)
+      yi += val[k] * x[idx[k]];
+    y[i] = yi;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  uint64_t seed = LFSR_SEED;
+  int i, k;
+  for (i = 0; i < SIZE; i++)
+    x[i] = i % 16 + 1;
+  for (i = 0; i < SIZE; i++)
+  {
+    ptr[i] = i * NNZ_PER_ROW;
+    verify_data[i] = 0;
+    for (k = 0; k < NNZ_PER_ROW; k++)
+    {
+      seed = lfsr(seed);
+      int j = seed % SIZE;
+      idx[ptr[i] + k] = j;
+      val[ptr[i] + k] = k + 1;
+      verify_data[i] += (k + 1) * x[j];
+    }
+  }
+  ptr[SIZE] = NNZ;
+
+  // Do the multiply
+  setStats(1);
+  spmv(SIZE, val, idx, x, ptr, results_data);
+  setStats(0);
+
+  // Check the results
+  return verifyDouble(SIZE, results_data, verify_data);
+}
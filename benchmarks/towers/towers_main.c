@@ -0,0 +1,63 @@
+// See LICENSE for license details.
+
+//**************************************************************************
+// Towers of Hanoi benchmark
+//--------------------------------------------------------------------------
+//
+// This benchmark recursively moves a tower of SIZE discs from the first to
+// the third of three pegs. The run takes 2^SIZE - 1 moves, so small changes
+// of SIZE scale it quickly. The result is checked by comparing the discs on
+// the third peg and the number of moves against the expected values.
+
+#include "util.h"
+
+#ifndef SIZE
+#define SIZE 12
+#endif
+
+struct Peg
+{
+  int height;
+  int discs[SIZE];
+};
+
+struct Peg pegs[3];
+long num_moves;
+
+int results_data[SIZE + 1];
+int verify_data[SIZE + 1];
+
+static void towers(int n, struct Peg* from, struct Peg* to, struct Peg* via)
+{
+  if (n == 0)
+    return;
+  towers(n - 1, from, via, to);
+  to->discs[to->height++] = from->discs[--from->height];
+  num_moves++;
+  towers(n - 1, via, to, from);
+}
+
+int main(int argc, char* argv[])
+{
+  int i;
+  for (i = 0; i < SIZE; i++)
+  {
+    pegs[0].discs[i] = SIZE - i;
+    verify_data[i] = SIZE - i;
+  }
+  pegs[0].height = SIZE;
+  verify_data[SIZE] = (1L << SIZE) - 1;
+
+  // Do the moves
+  setStats(1);
+  towers(SIZE, &pegs[0], &pegs[2], &pegs[1]);
+  setStats(0);
+
+  // Check the results
+  for (i = 0; i < SIZE; i++)
+    results_data[i] = pegs[2].discs[i];
+  results_data[SIZE] = num_moves;
+  if (pegs[0].height != 0 || pegs[1].height != 0 || pegs[2].height != SIZE)
+    return SIZE + 2;
+  return verify(SIZE + 1, results_data, verify_data);
+}
@@ -51,14 +51,37 @@ struct AxiOutputs {
   bool r_ready = false;
 };
 
+/// Static description of a port of the design, as listed in `ports.def`.
+struct PortInfo {
+  enum Dir { IN, OUT };
+  enum Group { CLOCK, RESET, DEBUG, MEM, MMIO, NUM_GROUPS };
+  static constexpr const char *GROUP_NAMES[] = {"clock", "reset", "debug",
+                                                "mem", "mmio"};
+
+  const char *name;
+  unsigned width;
+  Dir dir;
+  Group group;
+  /// Whether the port is tied to a constant by the design or the testbench.
+  bool constant;
+
+  /// Mask of the bits of a port value that are within the declared width.
+  constexpr uint64_t mask() const {
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+  }
+};
+
 /// Abstract interface to an Arcilator or Verilator model.
 class BoomModel {
 public:
-  static constexpr const char *PORT_NAMES[] = {
-#define PORT(name) #name,
+  static constexpr PortInfo PORTS[] = {
+#define PORT(name, width, dir, group)                                          \
+  {#name, width, PortInfo::dir, PortInfo::group, false},
+#define CONST_PORT(name, width, dir, group)                                    \
+  {#name, width, PortInfo::dir, PortInfo::group, true},
 #include "ports.def"
   };
-  static constexpr size_t NUM_PORTS = sizeof(PORT_NAMES) / sizeof(*PORT_NAMES);
+  static constexpr size_t NUM_PORTS = sizeof(PORTS) / sizeof(*PORTS);
   using Ports = std::array<uint64_t, NUM_PORTS>;
 
   BoomModel() {}
@@ -75,6 +98,10 @@ public:
   virtual void set_mmio(AxiInputs &in) {}
   virtual AxiOutputs get_mmio() { return {}; }
 
+  /// Raw model storage laid out as described by the Arcilator state file, or
+  /// null if the model does not expose its state.
+  virtual uint8_t *get_storage() { return nullptr; }
+
   const char *name = "unknown";
   std::chrono::high_resolution_clock::duration duration =
       std::chrono::high_resolution_clock::duration::zero();
@@ -82,3 +109,14 @@ public:
 
 std::unique_ptr<BoomModel> makeArcilatorModel();
 std::unique_ptr<BoomModel> makeVerilatorModel();
+
+/// Compile the arcilator model in `path` (`.ll`, `.bc`, or `.mlir`) through the
+/// LLVM JIT, caching objects in `cache_dir`, and let `makeArcilatorModel`
+/// return instances of it. Ports are bound through the state file at
+/// `state_path`, which is set to the one written by arcilator for MLIR inputs
+/// if empty. Prints what is compiled and loaded if `verbose` is set. Only
+/// available in the JIT testbench built with `ARC_JIT`, which has no
+/// `makeVerilatorModel`.
+bool loadJitModel(const std::string &path, std::string &state_path,
+                  const std::string &cache_dir, bool verbose,
+                  std::string &error);
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+# Content-addressed cache for model build products.
+#
+# Example:
+#   KEY=$(./build-cache.py key --input rocket/rocket-small-v1.6.fir.gz \
+#     --tool firtool --tool arcilator --flags "--mlir-timing")
+#   ./build-cache.py fetch -c ~/.cache/arc-tests -k $KEY -d build \
+#     rocket-arc.o rocket.json
+#   ./build-cache.py store -c ~/.cache/arc-tests -k $KEY \
+#     build/rocket-arc.o build/rocket.json
+#
+# The key hashes the contents of the input files, the `--version` output of
+# every tool, and the flags. Each key maps to a directory in the cache holding
+# the products by file name. `fetch` copies the products missing in the
+# destination directory from the cache, and only does so if the cache holds all
+# requested products. `store` adds products to the cache entry of a key, keeping
+# their modification times.
+
+import argparse
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+parser = argparse.ArgumentParser(description="Cache model build products")
+subparsers = parser.add_subparsers(dest="command", required=True)
+
+key_parser = subparsers.add_parser("key", help="print the key of a build")
+key_parser.add_argument("--input",
+                        metavar="FILE",
+                        action="append",
+                        default=list(),
+                        help="input file whose contents to hash (repeatable)")
+key_parser.add_argument("--tool",
+                        metavar="TOOL",
+                        action="append",
+                        default=list(),
+                        help="tool whose version to hash (repeatable)")
+key_parser.add_argument("--flags",
+                        metavar="FLAGS",
+                        action="append",
+                        default=list(),
+                        help="flags to hash (repeatable)")
+
+fetch_parser = subparsers.add_parser(
+    "fetch", help="copy cached products into a directory")
+fetch_parser.add_argument("-c",
+                          "--cache",
+                          metavar="DIR",
+                          required=True,
+                          help="cache directory")
+fetch_parser.add_argument("-k", "--key", required=True, help="build key")
+fetch_parser.add_argument("-d",
+                          "--dest",
+                          metavar="DIR",
+                          required=True,
+                          help="directory to copy the products to")
+fetch_parser.add_argument("products",
+                          metavar="FILE",
+                          nargs="+",
+                          help="file names of the products")
+
+store_parser = subparsers.add_parser("store",
+                                     help="add products to the cache")
+store_parser.add_argument("-c",
+                          "--cache",
+                          metavar="DIR",
+                          required=True,
+                          help="cache directory")
+store_parser.add_argument("-k", "--key", required=True, help="build key")
+store_parser.add_argument("products",
+                          metavar="FILE",
+                          nargs="+",
+                          help="products to store")
+args = parser.parse_args()
+
+
+def tool_version(tool):
+    try:
+        return subprocess.run([tool, "--version"],
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              text=True).stdout
+    except OSError:
+        return "missing"
+
+
+if args.command == "key":
+    h = hashlib.sha256()
+    for path in args.input:
+        with open(path, "rb") as f:
+            h.update(hashlib.sha256(f.read()).digest())
+    for tool in args.tool:
+        h.update(f"{tool}\0{tool_version(tool)}\0".encode())
+    for flags in args.flags:
+        h.update(f"{flags}\0".encode())
+    print(h.hexdigest())
+
+elif args.command == "fetch":
+    entry = os.path.join(args.cache, args.key)
+    if not all(
+            os.path.exists(os.path.join(entry, p)) for p in args.products):
+        sys.exit(1)
+    # Copy the products in the order they were built, such that make sees each
+    # one as newer than the products it was built from, and none as stale.
+    num_fetched = 0
+    for product in sorted(
+            args.products,
+            key=lambda p: os.path.getmtime(os.path.join(entry, p))):
+        dest = os.path.join(args.dest, product)
+        if not os.path.exists(dest):
+            shutil.copyfile(os.path.join(entry, product), dest)
+            num_fetched += 1
+    if num_fetched:
+        print(f"fetched {num_fetched} product(s) from {entry}",
+              file=sys.stderr)
+
+elif args.command == "store":
+    entry = os.path.join(args.cache, args.key)
+    os.makedirs(entry, exist_ok=True)
+
+    # Copy to a temporary file first, such that concurrent builds never see a
+    # partially written product.
+    for product in args.products:
+        fd, tmp = tempfile.mkstemp(dir=entry)
+        os.close(fd)
+        shutil.copy2(product, tmp)
+        os.replace(tmp, os.path.join(entry, os.path.basename(product)))
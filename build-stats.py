@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+
+# Measure the stages of a model build and summarize them as JSON.
+#
+# Example:
+#   ./build-stats.py run -l build/rocket-build.jsonl --stage arcilator \
+#     --stderr build/rocket-arc.timing.txt -- arcilator build/rocket.mlir ...
+#   ./build-stats.py report -l build/rocket-build.jsonl \
+#     -s firtool -s arcilator -s opt -s llc \
+#     --timing build/rocket-arc.timing.txt --ll build/rocket-arc.ll \
+#     --obj build/rocket-arc.o -o build/rocket-build.json
+#
+# `run` executes a command and appends its wall time and peak resident set size
+# to a log, one JSON record per line. Rebuilding a stage appends a new record,
+# of which `report` only considers the latest. Alternative builds of a model
+# share the log, so `report` can be limited to the stages of one build with
+# `--stage`, which its totals then only cover. `report` combines the log with
+# the MLIR pass timings and statistics printed by `--mlir-timing` and
+# `--mlir-pass-statistics`, the size of the LLVM IR and the object file, and
+# the size of every `*_eval` function in the object.
+
+from collections import OrderedDict
+import argparse
+import json
+import os
+import re
+import resource
+import shutil
+import subprocess
+import sys
+import time
+
+parser = argparse.ArgumentParser(description="Measure model build stages")
+subparsers = parser.add_subparsers(dest="command", required=True)
+
+run_parser = subparsers.add_parser("run",
+                                   help="run and measure one build stage")
+run_parser.add_argument("-l",
+                        "--log",
+                        metavar="FILE",
+                        required=True,
+                        help="stage log to append to")
+run_parser.add_argument("--stage", required=True, help="name of the stage")
+run_parser.add_argument(
+    "--stderr",
+    metavar="FILE",
+    help="also write the standard error of the command to a file")
+run_parser.add_argument("cmd",
+                        metavar="CMD",
+                        nargs=argparse.REMAINDER,
+                        help="command to run, after `--`")
+
+report_parser = subparsers.add_parser(
+    "report", help="summarize a build as JSON")
+report_parser.add_argument("-l",
+                           "--log",
+                           metavar="FILE",
+                           required=True,
+                           help="stage log written by `run`")
+report_parser.add_argument("-s",
+                           "--stage",
+                           action="append",
+                           default=list(),
+                           help="stage of the build to report (repeatable, "
+                           "default: all stages in the log)")
+report_parser.add_argument(
+    "--timing",
+    metavar="FILE",
+    help="output of a tool run with `--mlir-timing`")
+report_parser.add_argument("--ll",
+                           metavar="FILE",
+                           help="LLVM IR produced by arcilator")
+report_parser.add_argument("--obj",
+                           metavar="FILE",
+                           help="object file of the model")
+report_parser.add_argument("-o",
+                           "--output",
+                           metavar="FILE",
+                           help="output file (default: stdout)")
+args = parser.parse_args()
+
+#===-----------------------------------------------------------------------===#
+# Run
+#===-----------------------------------------------------------------------===#
+
+if args.command == "run":
+    cmd = args.cmd[1:] if args.cmd[:1] == ["--"] else args.cmd
+    if not cmd:
+        print("no command to run", file=sys.stderr)
+        sys.exit(1)
+
+    # Forward the standard error line by line, such that the output of long
+    # running tools still shows up as it is produced.
+    t_start = time.monotonic()
+    proc = subprocess.Popen(cmd,
+                            stderr=subprocess.PIPE if args.stderr else None,
+                            text=True)
+    if args.stderr:
+        with open(args.stderr, "w") as f:
+            for line in proc.stderr:
+                sys.stderr.write(line)
+                f.write(line)
+    returncode = proc.wait()
+    wall_seconds = time.monotonic() - t_start
+
+    # This process only ever waits for the one command, so the peak resident
+    # set size of its children is the one of the command and its subprocesses.
+    max_rss = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    if sys.platform != "darwin":
+        max_rss *= 1024
+
+    record = OrderedDict()
+    record["stage"] = args.stage
+    record["cmd"] = cmd
+    record["wall_seconds"] = wall_seconds
+    record["max_rss_bytes"] = max_rss
+    record["exit_code"] = returncode
+    with open(args.log, "a") as f:
+        f.write(json.dumps(record) + "\n")
+    sys.exit(returncode)
+
+#===-----------------------------------------------------------------------===#
+# Report
+#===-----------------------------------------------------------------------===#
+
+
+def parse_timing(lines):
+    """Parse the execution time report of `--mlir-timing` into a tree of
+    passes, and return the total time and the tree. Each pass lists its wall
+    time and nested passes. Only the last column of a report with multiple
+    time columns is used, which is the wall time."""
+    total = None
+    root = OrderedDict(passes=list())
+    stack = [(-1, root)]
+    in_report = False
+    for line in lines:
+        if "Execution time report" in line:
+            in_report = True
+            continue
+        if not in_report:
+            continue
+        match = re.match(r'\s*Total Execution Time: ([\d.]+) seconds', line)
+        if match:
+            total = float(match.group(1))
+            continue
+        match = re.match(r'((?:\s*[\d.]+ \(\s*[\d.]+%\))+)(\s+)(\S.*)$', line)
+        if not match:
+            if line.startswith("===") and total is not None and len(stack) > 1:
+                break
+            continue
+        # Nested passes are indented further between the times and the name.
+        indent = len(match.group(2))
+        seconds = float(re.findall(r'([\d.]+) \(', match.group(1))[-1])
+        name = match.group(3).strip()
+        if name == "Total":
+            continue
+        node = OrderedDict(name=name, wall_seconds=seconds, passes=list())
+        while stack[-1][0] >= indent:
+            stack.pop()
+        stack[-1][1]["passes"].append(node)
+        stack.append((indent, node))
+
+    # Drop empty lists of nested passes to keep the output compact.
+    def prune(node):
+        for child in node["passes"]:
+            prune(child)
+        if not node["passes"]:
+            del node["passes"]
+
+    prune(root)
+    return total, root.get("passes", [])
+
+
+def parse_statistics(lines):
+    """Parse the report of `--mlir-pass-statistics` into a map from pass name
+    to its statistics."""
+    stats = OrderedDict()
+    in_report = False
+    current = None
+    for line in lines:
+        if "Pass statistics report" in line:
+            in_report = True
+            continue
+        if not in_report:
+            continue
+        if line.startswith("===") and stats:
+            break
+        match = re.match(r'\s*\(S\)\s+(\d+)\s+(\S+)', line)
+        if match:
+            if current is not None:
+                stats.setdefault(current, OrderedDict())[match.group(2)] = int(
+                    match.group(1))
+            continue
+        if line.strip() and not line.startswith("==="):
+            current = line.strip()
+    return stats
+
+
+def function_sizes(obj):
+    """Return the size of every function defined in an object file."""
+    nm = shutil.which("llvm-nm") or shutil.which("nm")
+    if not nm:
+        return OrderedDict()
+    output = subprocess.run([nm, "--print-size", "--defined-only", obj],
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL,
+                            text=True).stdout
+    sizes = OrderedDict()
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in ("T", "t"):
+            sizes[fields[3].lstrip("_") if sys.platform == "darwin" else
+                  fields[3]] = int(fields[1], 16)
+    return sizes
+
+
+# Keep the latest record of every stage, in the order the stages first ran.
+stages = OrderedDict()
+with open(args.log) as f:
+    for line in f:
+        if line.strip():
+            record = json.loads(line)
+            if not args.stage or record["stage"] in args.stage:
+                stages[record["stage"]] = record
+
+report = OrderedDict()
+report["stages"] = OrderedDict()
+for name, record in stages.items():
+    report["stages"][name] = OrderedDict([
+        ("wall_seconds", record["wall_seconds"]),
+        ("max_rss_bytes", record["max_rss_bytes"]),
+    ])
+report["wall_seconds"] = sum(r["wall_seconds"] for r in stages.values())
+report["max_rss_bytes"] = max([r["max_rss_bytes"] for r in stages.values()],
+                              default=0)
+
+if args.timing:
+    with open(args.timing) as f:
+        lines = f.read().splitlines()
+    total, passes = parse_timing(lines)
+    report["mlir_timing"] = OrderedDict([("wall_seconds", total),
+                                         ("passes", passes)])
+    report["mlir_pass_statistics"] = parse_statistics(lines)
+
+if args.ll:
+    report["ll_bytes"] = os.path.getsize(args.ll)
+
+if args.obj:
+    report["obj_bytes"] = os.path.getsize(args.obj)
+    sizes = function_sizes(args.obj)
+    report["text_bytes"] = sum(sizes.values())
+    report["num_functions"] = len(sizes)
+    report["eval_functions"] = OrderedDict(
+        (name, size) for name, size in sizes.items() if name.endswith("_eval"))
+
+output = json.dumps(report, indent=2) + "\n"
+if args.output:
+    with open(args.output, "w") as f:
+        f.write(output)
+else:
+    sys.stdout.write(output)
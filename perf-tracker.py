@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+
+# Record benchmark results in a store and compare them against a baseline.
+#
+# Example:
+#   build/small-v1.6/rocket-main --bench 10 benchmarks/dhrystone.riscv |
+#     ./perf-tracker.py record --config small-v1.6 --binary dhrystone.riscv
+#   ./perf-tracker.py compare --baseline arcilator="firtool-1.60.0" \
+#     --candidate arcilator="firtool-1.61.0"
+#
+# Without `--baseline` and `--candidate`, `compare` checks the latest run of
+# every config and binary against all earlier runs, which suits gating a CI job
+# right after `record`. Exits with 1 if any regression is found.
+
+from collections import OrderedDict
+from datetime import datetime, timezone
+import argparse
+import json
+import math
+import platform
+import shutil
+import subprocess
+import sys
+
+# Fields that identify comparable runs.
+GROUP_KEYS = ["config", "binary", "model", "host"]
+
+parser = argparse.ArgumentParser(
+    description="Track simulator performance across runs")
+parser.add_argument("-s",
+                    "--store",
+                    metavar="FILE",
+                    default="perf-results.jsonl",
+                    help="results store, one JSON record per line")
+subparsers = parser.add_subparsers(dest="command", required=True)
+
+record_parser = subparsers.add_parser(
+    "record", help="add benchmark results to the store")
+record_parser.add_argument(
+    "input",
+    metavar="JSON",
+    nargs="?",
+    help="output of `--bench` or benchmark.py (default: stdin)")
+record_parser.add_argument("--config",
+                           required=True,
+                           help="design config, e.g. small-v1.6")
+record_parser.add_argument("--binary",
+                           required=True,
+                           help="benchmark binary that was simulated")
+record_parser.add_argument("--model",
+                           default="arcs",
+                           help="simulated model (default: arcs)")
+record_parser.add_argument(
+    "--arcilator-version",
+    metavar="VERSION",
+    help="arcilator version (default: ask `arcilator --version`)")
+record_parser.add_argument("--host",
+                           default=platform.node(),
+                           help="host name (default: this host)")
+record_parser.add_argument("-m",
+                           "--metadata",
+                           metavar=("KEY", "VALUE"),
+                           nargs=2,
+                           action="append",
+                           default=list(),
+                           help="additional fields to add to the record")
+
+compare_parser = subparsers.add_parser(
+    "compare", help="compare candidate runs against baseline runs")
+compare_parser.add_argument(
+    "--baseline",
+    metavar="KEY=VALUE",
+    action="append",
+    default=list(),
+    help="select baseline runs by record field (repeatable)")
+compare_parser.add_argument(
+    "--candidate",
+    metavar="KEY=VALUE",
+    action="append",
+    default=list(),
+    help="select candidate runs by record field (repeatable)")
+compare_parser.add_argument(
+    "--threshold",
+    type=float,
+    default=2.0,
+    help="flag frequency changes beyond this many percent (default: 2)")
+compare_parser.add_argument(
+    "--inst-threshold",
+    type=float,
+    default=1.0,
+    help="flag instruction count changes beyond this many percent "
+    "(default: 1)")
+compare_parser.add_argument(
+    "--alpha",
+    type=float,
+    default=0.05,
+    help="significance level of the frequency test (default: 0.05)")
+args = parser.parse_args()
+
+
+def load_store(path):
+    records = list()
+    try:
+        with open(path) as f:
+            for line in f:
+                if line.strip():
+                    records.append(json.loads(line))
+    except FileNotFoundError:
+        pass
+    return records
+
+
+def arcilator_version():
+    if not shutil.which("arcilator"):
+        return "unknown"
+    output = subprocess.run(["arcilator", "--version"],
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            text=True).stdout
+    for line in output.splitlines():
+        if "version" in line.lower():
+            return line.strip()
+    return output.strip().split("\n")[0] if output.strip() else "unknown"
+
+
+def host_cpu():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    if n % 2:
+        return values[n // 2]
+    return (values[n // 2 - 1] + values[n // 2]) / 2
+
+
+def mann_whitney(a, b):
+    """Two-sided p-value of the Mann-Whitney U test, using the normal
+    approximation with tie and continuity correction. Does not assume the
+    frequencies are normally distributed, which they rarely are."""
+    n1, n2 = len(a), len(b)
+    n = n1 + n2
+    values = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    ranks = [0.0] * n
+    ties = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        t = j - i + 1
+        ties += t**3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, group) in zip(ranks, values) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+    mu = n1 * n2 / 2
+    sigma = math.sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))))
+    if sigma == 0:
+        return 1.0
+    z = max(abs(u - mu) - 0.5, 0) / sigma
+    return math.erfc(z / math.sqrt(2))
+
+
+def matches(record, selectors):
+    for selector in selectors:
+        key, _, value = selector.partition("=")
+        if str(record.get(key, record.get("result", {}).get(key))) != value:
+            return False
+    return True
+
+
+def freq_samples(records):
+    samples = list()
+    for record in records:
+        result = record.get("result", {})
+        samples += result.get("freq_samples", [result.get("freq")])
+    return [x for x in samples if x is not None]
+
+
+#===-----------------------------------------------------------------------===#
+# Record
+#===-----------------------------------------------------------------------===#
+
+if args.command == "record":
+    text = open(args.input).read() if args.input else sys.stdin.read()
+    results = [json.loads(line) for line in text.splitlines() if line.strip()]
+    if not results:
+        print("no benchmark results in input", file=sys.stderr)
+        sys.exit(1)
+    version = args.arcilator_version or arcilator_version()
+    with open(args.store, "a") as f:
+        for result in results:
+            record = OrderedDict()
+            record["time"] = datetime.now(timezone.utc).isoformat()
+            record["config"] = args.config
+            record["binary"] = args.binary
+            record["model"] = args.model
+            record["arcilator"] = version
+            record["host"] = args.host
+            record["cpu"] = host_cpu()
+            for key, value in args.metadata:
+                record[key] = value
+            record["result"] = result
+            f.write(json.dumps(record) + "\n")
+    print(f"recorded {len(results)} run(s) in {args.store}", file=sys.stderr)
+    sys.exit(0)
+
+#===-----------------------------------------------------------------------===#
+# Compare
+#===-----------------------------------------------------------------------===#
+
+records = load_store(args.store)
+groups = OrderedDict()
+for record in records:
+    key = tuple(record.get(k) for k in GROUP_KEYS)
+    groups.setdefault(key, list()).append(record)
+
+num_regressions = 0
+num_compared = 0
+for key, runs in groups.items():
+    if args.baseline or args.candidate:
+        baseline = [r for r in runs if matches(r, args.baseline)]
+        candidate = [r for r in runs if matches(r, args.candidate)]
+    else:
+        baseline, candidate = runs[:-1], runs[-1:]
+    if not baseline or not candidate:
+        continue
+    num_compared += 1
+    name = " ".join(str(k) for k in key)
+    print(f"{name}: {len(baseline)} baseline vs. {len(candidate)} candidate "
+          f"run(s)")
+
+    # Frequency: only flag changes that are both large and significant.
+    base_freq = freq_samples(baseline)
+    cand_freq = freq_samples(candidate)
+    if base_freq and cand_freq:
+        change = (median(cand_freq) / median(base_freq) - 1) * 100
+        p = mann_whitney(base_freq, cand_freq)
+        if len(base_freq) < 3 or len(cand_freq) < 3:
+            verdict = "too few samples"
+        elif p >= args.alpha or abs(change) <= args.threshold:
+            verdict = "unchanged"
+        elif change < 0:
+            verdict = "REGRESSION"
+            num_regressions += 1
+        else:
+            verdict = "improvement"
+        print(f"  freq:      {median(base_freq):14.1f} -> "
+              f"{median(cand_freq):14.1f} Hz  {change:+6.2f}%  p={p:.3g}  "
+              f"{verdict}")
+
+    # Instruction counts are nearly deterministic; compare medians directly.
+    base_inst = [
+        r["result"]["exec_inst"] for r in baseline
+        if "exec_inst" in r.get("result", {})
+    ]
+    cand_inst = [
+        r["result"]["exec_inst"] for r in candidate
+        if "exec_inst" in r.get("result", {})
+    ]
+    if base_inst and cand_inst:
+        change = (median(cand_inst) / median(base_inst) - 1) * 100
+        if abs(change) <= args.inst_threshold:
+            verdict = "unchanged"
+        elif change > 0:
+            verdict = "REGRESSION"
+            num_regressions += 1
+        else:
+            verdict = "improvement"
+        print(f"  exec_inst: {median(base_inst):14.0f} -> "
+              f"{median(cand_inst):14.0f}     {change:+6.2f}%  {verdict}")
+
+if num_compared == 0:
+    print("no runs to compare", file=sys.stderr)
+print(f"{num_regressions} regression(s) in {num_compared} comparison(s)",
+      file=sys.stderr)
+sys.exit(1 if num_regressions > 0 else 0)
@@ -1,29 +1,131 @@
+#include "arc-state.h"
 #include "elfio/elfio.hpp"
 #include "rocket-model.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <iomanip>
 #include <iostream>
-#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#if defined(__AVX2__) || defined(__AVX512F__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <asm/unistd.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#endif
 
 #define TOHOST_ADDR 0x60000000
 #define FROMHOST_ADDR 0x60000040
 #define TOHOST_DATA_ADDR 0x60000080
 #define TOHOST_DATA_SIZE 64 // bytes
+#define TOHOST_STATS_ADDR 0x600000C0
+#define MAILBOX_SIZE 0x100 // bytes per hart, see benchmarks/common/mailbox.h
+#define MAX_HARTS 8
+#define UART_ADDR 0x60010000
+#define TIMER_ADDR 0x60020000
+#define MAGIC_ADDR 0x60030000
 #define SYS_write 64
-
-static bool finished = false;
+#define MAX_CYCLES 1000000
 
 RocketModel::~RocketModel() {}
 
+/// Whether the `n` words at `a` and `b` are equal in the bits set in `mask`.
+/// Compares 8 or 4 words per instruction with AVX-512 or AVX2, and falls back
+/// to accumulating the differences without branching.
+static inline bool words_equal(const uint64_t *a, const uint64_t *b,
+                               const uint64_t *mask, size_t n) {
+  size_t i = 0;
+#if defined(__AVX512F__)
+  for (; i + 8 <= n; i += 8)
+    if (_mm512_test_epi64_mask(
+            _mm512_xor_si512(_mm512_loadu_si512(a + i),
+                             _mm512_loadu_si512(b + i)),
+            _mm512_loadu_si512(mask + i)))
+      return false;
+#elif defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    __m256i diff = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+    __m256i bits =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+    if (!_mm256_testz_si256(diff, bits))
+      return false;
+  }
+#endif
+  uint64_t diff = 0;
+  for (; i < n; ++i)
+    diff |= (a[i] ^ b[i]) & mask[i];
+  return diff == 0;
+}
+
+/// Hash the bits set in `mask` of the `n` words at `data`. Uses four
+/// independent lanes such that the compiler can vectorize the loop.
+static inline uint64_t hash_words(const uint64_t *data, const uint64_t *mask,
+                                  size_t n) {
+  constexpr uint64_t K = 0x9E3779B97F4A7C15;
+  uint64_t lanes[4] = {K, K * 3, K * 5, K * 7};
+  size_t num_blocks = n / 4;
+  for (size_t i = 0; i < num_blocks; ++i)
+    for (unsigned l = 0; l < 4; ++l)
+      lanes[l] = (lanes[l] ^ (data[i * 4 + l] & mask[i * 4 + l])) * K;
+  for (size_t i = num_blocks * 4; i < n; ++i)
+    lanes[0] = (lanes[0] ^ (data[i] & mask[i])) * K;
+  return ((lanes[0] * K ^ lanes[1]) * K ^ lanes[2]) * K ^ lanes[3];
+}
+
+/// Fold `digest` into the rolling hash `hash`. For a given digest this is a
+/// bijection on the hash, so hashes that diverged once never converge again.
+static inline uint64_t roll_hash(uint64_t hash, uint64_t digest) {
+  return ((hash << 27 | hash >> 37) ^ digest) * 0x9E3779B97F4A7C15;
+}
+
 class ComparingRocketModel : public RocketModel {
 public:
   std::vector<std::unique_ptr<RocketModel>> models;
   size_t cycle = 0;
   size_t num_mismatches = 0;
+  bool quiet = false;
+  /// Fold the ports of each model into a rolling hash every cycle, and only
+  /// compare the hashes and the ports every this many cycles. Compare the
+  /// ports every cycle if zero.
+  size_t hash_interval = 0;
+  /// Bits of each port that are compared. Defaults to the declared width of
+  /// every port that is not known to be constant.
+  Ports compare_mask = DEFAULT_COMPARE_MASK;
+
+  /// Compare only the ports in the groups set in the `groups` bit mask
+  /// (indexed by `PortInfo::Group`), and only the outputs of the design if
+  /// `outputs_only` is set. Constant ports are never compared.
+  void select_ports(unsigned groups, bool outputs_only) {
+    for (size_t i = 0; i < NUM_PORTS; ++i) {
+      bool selected = (groups >> PORTS[i].group & 1) &&
+                      (!outputs_only || PORTS[i].dir == PortInfo::OUT);
+      compare_mask[i] = selected ? DEFAULT_COMPARE_MASK[i] : 0;
+    }
+  }
 
   virtual ~ComparingRocketModel() {
+    if (quiet)
+      return;
     std::cerr << "----------------------------------------\n";
     std::cerr << cycle << " cycles total\n";
     for (auto &model : models) {
@@ -100,26 +202,225 @@ public:
     return models[0]->get_mmio();
   }
 
+  uint8_t *get_storage() override {
+    for (auto &model : models)
+      if (auto *storage = model->get_storage())
+        return storage;
+    return nullptr;
+  }
+
   void compare_ports() {
     if (models.size() < 2)
       return;
     auto portsA = models[0]->get_ports();
+    if (hash_interval > 0 && !compare_hashes(portsA))
+      return;
     for (unsigned modelIdx = 1; modelIdx < models.size(); ++modelIdx) {
       auto portsB = models[modelIdx]->get_ports();
+      if (words_equal(portsA.data(), portsB.data(), compare_mask.data(),
+                      portsA.size()))
+        continue;
       for (unsigned portIdx = 0; portIdx < portsA.size(); ++portIdx) {
-        if (portsA[portIdx] == portsB[portIdx])
+        uint64_t valueA = portsA[portIdx] & compare_mask[portIdx];
+        uint64_t valueB = portsB[portIdx] & compare_mask[portIdx];
+        if (valueA == valueB)
           continue;
         ++num_mismatches;
         std::cerr << "cycle " << cycle << ": mismatching " << std::hex
-                  << PORT_NAMES[portIdx] << ": " << portsA[portIdx] << " ("
-                  << models[0]->name << ") != " << portsB[portIdx] << " ("
+                  << PORTS[portIdx].name << ": " << valueA << " ("
+                  << models[0]->name << ") != " << valueB << " ("
                   << models[modelIdx]->name << ")\n"
                   << std::dec;
       }
     }
   }
+
+private:
+  static constexpr Ports DEFAULT_COMPARE_MASK = [] {
+    Ports masks{};
+    for (size_t i = 0; i < NUM_PORTS; ++i)
+      masks[i] = PORTS[i].constant ? 0 : PORTS[i].mask();
+    return masks;
+  }();
+
+  std::vector<uint64_t> hashes;
+  size_t last_hash_check = 0;
+
+  /// Update the rolling port hashes. Returns whether the ports should be
+  /// compared in this cycle, which also reports a divergence of the hashes.
+  bool compare_hashes(const Ports &portsA) {
+    hashes.resize(models.size());
+    hashes[0] = roll_hash(hashes[0], hash_words(portsA.data(),
+                                                compare_mask.data(),
+                                                portsA.size()));
+    for (unsigned modelIdx = 1; modelIdx < models.size(); ++modelIdx) {
+      auto ports = models[modelIdx]->get_ports();
+      hashes[modelIdx] = roll_hash(
+          hashes[modelIdx],
+          hash_words(ports.data(), compare_mask.data(), ports.size()));
+    }
+    if (cycle - last_hash_check < hash_interval)
+      return false;
+    for (unsigned modelIdx = 1; modelIdx < models.size(); ++modelIdx) {
+      if (hashes[modelIdx] == hashes[0])
+        continue;
+      ++num_mismatches;
+      std::cerr << "cycles " << last_hash_check << " to " << cycle
+                << ": ports of " << models[modelIdx]->name
+                << " diverged from " << models[0]->name << "\n";
+      hashes[modelIdx] = hashes[0];
+    }
+    last_hash_check = cycle;
+    return true;
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// Write Strobes
+//===----------------------------------------------------------------------===//
+
+/// Byte mask for each value of an 8 bit write strobe, with every set strobe
+/// bit expanded to a 0xFF byte.
+static constexpr auto STRB_BYTE_MASKS = [] {
+  std::array<uint64_t, 256> masks{};
+  for (unsigned strb = 0; strb < 256; ++strb)
+    for (unsigned i = 0; i < 8; ++i)
+      if (strb >> i & 1)
+        masks[strb] |= uint64_t(0xFF) << (i * 8);
+  return masks;
+}();
+
+/// Expand 8 strobe bits into a mask of the bytes they enable.
+static inline uint64_t strb_byte_mask(uint8_t strb) {
+#ifdef __BMI2__
+  return _pdep_u64(strb, 0x0101010101010101) * 0xFF;
+#else
+  return STRB_BYTE_MASKS[strb];
+#endif
+}
+
+/// Merge the bytes of `data` enabled by `strb` into the `num_bytes` at `dst`,
+/// which must be a multiple of 8. The strobe holds one bit per byte of data,
+/// such that buses of any width merge 8 bytes per strobe byte.
+static inline void masked_merge(uint8_t *dst, const uint8_t *data,
+                                const uint8_t *strb, size_t num_bytes) {
+  for (size_t i = 0; i < num_bytes; i += 8) {
+    uint64_t mask = strb_byte_mask(strb[i / 8]);
+    uint64_t old_word, new_word;
+    memcpy(&old_word, dst + i, 8);
+    memcpy(&new_word, data + i, 8);
+    old_word ^= (old_word ^ new_word) & mask;
+    memcpy(dst + i, &old_word, 8);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Memory Timing
+//===----------------------------------------------------------------------===//
+
+/// Memory that answers every burst in the cycle after it was accepted. An
+/// `AxiPort` with this policy compiles all timing checks away.
+struct IdealTiming {
+  static constexpr bool IDEAL = true;
+
+  /// Returns the first cycle in which the burst may present its response.
+  size_t schedule(size_t cycle, size_t addr, unsigned num_beats, bool write) {
+    return cycle + 1;
+  }
+};
+
+/// Memory that answers every burst a fixed number of cycles after it was
+/// accepted, regardless of address and load.
+struct FixedLatencyTiming {
+  static constexpr bool IDEAL = false;
+  unsigned latency = 20;
+
+  size_t schedule(size_t cycle, size_t addr, unsigned num_beats, bool write) {
+    return cycle + latency;
+  }
+};
+
+/// DRAM with independent banks that each keep one row open. Bursts hitting the
+/// open row are answered faster than those that have to open a new one, and a
+/// bank serves one burst at a time, which limits the bandwidth of accesses
+/// concentrated on few banks.
+struct BankedTiming {
+  static constexpr bool IDEAL = false;
+  static constexpr unsigned MAX_BANKS = 64;
+  unsigned num_banks = 8;
+  unsigned row_size = 2048; // bytes
+  unsigned hit_latency = 14;
+  unsigned miss_latency = 42;
+
+  size_t schedule(size_t cycle, size_t addr, unsigned num_beats, bool write) {
+    size_t row = addr / row_size;
+    unsigned bank = row % num_banks;
+    size_t start = std::max(cycle, bank_busy[bank]);
+    bool hit = open_row[bank] == row + 1;
+    size_t ready = start + (hit ? hit_latency : miss_latency);
+    open_row[bank] = row + 1;
+    bank_busy[bank] = ready + num_beats;
+    return ready;
+  }
+
+private:
+  /// Open row plus one of each bank, or zero if the bank has no open row.
+  size_t open_row[MAX_BANKS] = {};
+  size_t bank_busy[MAX_BANKS] = {};
+};
+
+/// FIFO over a power-of-two ring of slots that grows on demand, such that a
+/// queue of in-flight bursts settles at a fixed allocation.
+template <typename T>
+class RingBuffer {
+public:
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  T &operator[](size_t index) { return slots[(head + index) & mask]; }
+  const T &operator[](size_t index) const {
+    return slots[(head + index) & mask];
+  }
+  T &front() { return slots[head]; }
+
+  void push_back(const T &value) {
+    if (count == slots.size())
+      grow();
+    slots[(head + count++) & mask] = value;
+  }
+  void pop_front() {
+    head = (head + 1) & mask;
+    --count;
+  }
+  /// Remove the element at `index`, keeping the order of the others.
+  void erase(size_t index) {
+    for (size_t i = index; i > 0; --i)
+      (*this)[i] = (*this)[i - 1];
+    pop_front();
+  }
+
+private:
+  void grow() {
+    std::vector<T> grown(std::max<size_t>(slots.size() * 2, 4));
+    for (size_t i = 0; i < count; ++i)
+      grown[i] = (*this)[i];
+    slots = std::move(grown);
+    head = 0;
+    mask = slots.size() - 1;
+  }
+
+  std::vector<T> slots;
+  size_t head = 0;
+  size_t count = 0;
+  size_t mask = 0;
 };
 
+//===----------------------------------------------------------------------===//
+// AXI Port
+//===----------------------------------------------------------------------===//
+
+/// Subordinate end of an AXI4 port. The `Timing` policy decides when the
+/// memory behind the port responds to each burst.
+template <typename Timing = IdealTiming>
 struct AxiPort {
   enum {
     RESP_OKAY = 0b00,
@@ -130,275 +431,2305 @@ struct AxiPort {
 
   AxiInputs in;
   AxiOutputs out;
+  Timing timing;
 
   void update_a();
   void update_b();
 
   std::function<void(size_t addr, size_t &data)> readFn;
   std::function<void(size_t addr, size_t data, size_t mask)> writeFn;
+  /// Resolves a full-width burst of `num_bytes` at `addr` to contiguous host
+  /// memory when the burst is accepted, such that its beats can be served by
+  /// incrementing a pointer. Returns null if the range is not backed by plain
+  /// memory, in which case the beats go through `readFn` and `writeFn`.
+  std::function<uint8_t *(size_t addr, size_t num_bytes, bool write)> spanFn;
+
+  /// Maximum number of read bursts, and separately write bursts, accepted but
+  /// not yet completed. Responses with the same ID are always returned in the
+  /// order the requests were accepted.
+  unsigned max_outstanding = 1;
+  /// Interleave the read data beats of bursts with different IDs round-robin,
+  /// instead of completing one burst before starting the next.
+  bool interleave = false;
+
+  /// Whether no burst is in flight.
+  bool idle() const {
+    return reads.empty() && writes.empty() && write_acks.empty();
+  }
+
+  /// Account for `n` cycles in which the port was idle and not updated.
+  void skip_cycles(size_t n = 1) {
+    if constexpr (!Timing::IDEAL)
+      cycle += n;
+  }
 
 private:
-  unsigned read_beats_left = 0;
-  size_t read_id;
-  size_t read_addr;
-  size_t read_size; // log2
-  unsigned write_beats_left = 0;
-  size_t write_id;
-  size_t write_addr;
-  size_t write_size; // log2
-  bool write_acked = true;
+  struct Burst {
+    size_t id;
+    size_t addr;
+    size_t size; // log2
+    unsigned beats_left;
+    uint8_t *ptr;
+    size_t ready; // first cycle to respond in
+  };
+  struct Ack {
+    size_t id;
+    size_t ready;
+  };
+  Burst accept_burst(size_t id, size_t addr, size_t size, size_t len,
+                     bool write);
+  int next_read() const;
+
+  /// Current cycle of the port, counted only if the memory is not ideal.
+  size_t cycle = 0;
+  /// Reads in the order they were accepted.
+  RingBuffer<Burst> reads;
+  /// Earliest cycle in which any queued read becomes ready.
+  size_t reads_ready = 0;
+  /// Writes waiting for data, in the order they were accepted. AXI4 write data
+  /// carries no ID and always arrives in this order.
+  RingBuffer<Burst> writes;
+  /// Completed writes waiting for their acknowledge.
+  RingBuffer<Ack> write_acks;
+  /// Index into `reads` of the burst presenting data this cycle.
+  unsigned read_sel = 0;
+  /// Whether `read_sel` has started, but not finished, its data beats.
+  bool read_started = false;
+  /// Number of read beats transferred, to rotate between interleaved IDs.
+  unsigned read_turn = 0;
 };
 
-void AxiPort::update_a() {
+template <typename Timing>
+typename AxiPort<Timing>::Burst
+AxiPort<Timing>::accept_burst(size_t id, size_t addr, size_t size, size_t len,
+                              bool write) {
+  Burst burst;
+  burst.id = id;
+  burst.addr = addr;
+  burst.size = size;
+  burst.beats_left = len + 1;
+  burst.ptr = nullptr;
+  burst.ready = 0;
+  if constexpr (!Timing::IDEAL)
+    burst.ready = timing.schedule(cycle, addr, burst.beats_left, write);
+  if (spanFn && size == 3 && addr % 8 == 0)
+    burst.ptr = spanFn(addr, burst.beats_left * 8, write);
+  return burst;
+}
+
+/// Pick the read burst to present data for, or -1 if none is ready. Only the
+/// oldest burst of each ID is eligible, which keeps responses in order per ID.
+template <typename Timing>
+int AxiPort<Timing>::next_read() const {
+  // Ideal memory has every burst ready right away, so the oldest one wins.
+  if constexpr (Timing::IDEAL)
+    if (!interleave)
+      return 0;
+  if (!interleave && read_started)
+    return read_sel;
+  auto is_eligible = [&](unsigned i) {
+    if (reads[i].ready > cycle)
+      return false;
+    for (unsigned j = 0; j < i; ++j)
+      if (reads[j].id == reads[i].id)
+        return false;
+    return true;
+  };
+  unsigned num_eligible = 0;
+  for (unsigned i = 0; i < reads.size(); ++i) {
+    if (!is_eligible(i))
+      continue;
+    if (!interleave)
+      return i;
+    ++num_eligible;
+  }
+  if (num_eligible == 0)
+    return -1;
+  unsigned turn = read_turn % num_eligible;
+  for (unsigned i = 0; i < reads.size(); ++i)
+    if (is_eligible(i) && turn-- == 0)
+      return i;
+  return -1;
+}
+
+template <typename Timing>
+void AxiPort<Timing>::update_a() {
   // Present read data.
   in.r_valid = false;
   in.r_id = 0;
   in.r_data = 0;
   in.r_resp = RESP_OKAY;
   in.r_last = false;
-  if (read_beats_left > 0) {
-    in.r_valid = true;
-    in.r_id = read_id;
-    if (readFn)
-      readFn(read_addr, in.r_data);
-    else
-      in.r_data = 0x1050007310500073; // wfi
-    in.r_last = read_beats_left == 1;
+  bool reads_pending = !reads.empty();
+  if constexpr (!Timing::IDEAL)
+    reads_pending = reads_pending && cycle >= reads_ready;
+  if (reads_pending) {
+    int sel = next_read();
+    if (sel >= 0) {
+      read_sel = sel;
+      auto &burst = reads[read_sel];
+      in.r_valid = true;
+      in.r_id = burst.id;
+      if (burst.ptr)
+        memcpy(&in.r_data, burst.ptr, sizeof(in.r_data));
+      else if (readFn)
+        readFn(burst.addr, in.r_data);
+      else
+        in.r_data = 0x1050007310500073; // wfi
+      in.r_last = burst.beats_left == 1;
+    }
   }
 
   // Present write acknowledge.
   in.b_valid = false;
   in.b_id = 0;
   in.b_resp = RESP_OKAY;
-  if (write_beats_left == 0 && !write_acked) {
-    in.b_valid = true;
-    in.b_id = write_id;
+  if (!write_acks.empty()) {
+    in.b_valid = Timing::IDEAL || write_acks.front().ready <= cycle;
+    in.b_id = in.b_valid ? write_acks.front().id : 0;
   }
 
   // Handle write data.
-  in.w_ready = write_beats_left > 0;
+  in.w_ready = !writes.empty();
   if (out.w_valid && in.w_ready) {
-    if (writeFn) {
-      size_t strb = out.w_strb;
-      strb &= ((1 << (1 << write_size)) - 1) << (write_addr % 8);
-      writeFn(write_addr, out.w_data, strb);
+    auto &burst = writes.front();
+    if (burst.ptr) {
+      uint8_t strb = out.w_strb;
+      if (strb == 0xFF)
+        memcpy(burst.ptr, &out.w_data, sizeof(out.w_data));
+      else
+        masked_merge(burst.ptr, reinterpret_cast<const uint8_t *>(&out.w_data),
+                     &strb, sizeof(out.w_data));
+      burst.ptr += 8;
+      burst.addr += 8;
+    } else {
+      if (writeFn) {
+        size_t strb = out.w_strb;
+        strb &= ((1 << (1 << burst.size)) - 1) << (burst.addr % 8);
+        writeFn(burst.addr, out.w_data, strb);
+      }
+      burst.addr = ((burst.addr >> burst.size) + 1) << burst.size;
+    }
+    assert(out.w_last == (burst.beats_left == 1));
+    if (--burst.beats_left == 0) {
+      write_acks.push_back({burst.id, std::max(burst.ready, cycle + 1)});
+      writes.pop_front();
     }
-    assert(out.w_last == (write_beats_left == 1));
-    --write_beats_left;
-    write_addr = ((write_addr >> write_size) + 1) << write_size;
   }
 
-  in.aw_ready = write_beats_left == 0 && write_acked;
-  in.ar_ready = read_beats_left == 0;
+  in.aw_ready = writes.size() + write_acks.size() < max_outstanding;
+  in.ar_ready = reads.size() < max_outstanding;
 
   // Accept new reads.
   if (out.ar_valid && in.ar_ready) {
-    read_beats_left = out.ar_len + 1;
-    read_id = out.ar_id;
-    read_addr = out.ar_addr;
-    read_size = out.ar_size;
+    auto burst =
+        accept_burst(out.ar_id, out.ar_addr, out.ar_size, out.ar_len, false);
+    if constexpr (!Timing::IDEAL)
+      if (reads.empty() || burst.ready < reads_ready)
+        reads_ready = burst.ready;
+    reads.push_back(burst);
   }
 
   // Accept new writes.
-  if (out.aw_valid && in.aw_ready) {
-    write_beats_left = out.aw_len + 1;
-    write_id = out.aw_id;
-    write_addr = out.aw_addr;
-    write_size = out.aw_size;
-    write_acked = false;
-  }
+  if (out.aw_valid && in.aw_ready)
+    writes.push_back(
+        accept_burst(out.aw_id, out.aw_addr, out.aw_size, out.aw_len, true));
 }
 
-void AxiPort::update_b() {
+template <typename Timing>
+void AxiPort<Timing>::update_b() {
   if (in.r_valid && out.r_ready) {
-    --read_beats_left;
-    read_addr = ((read_addr >> read_size) + 1) << read_size;
+    auto &burst = reads[read_sel];
+    if (burst.ptr)
+      burst.ptr += 8;
+    else
+      burst.addr = ((burst.addr >> burst.size) + 1) << burst.size;
+    read_started = --burst.beats_left != 0;
+    if (!read_started) {
+      reads.erase(read_sel);
+      if constexpr (!Timing::IDEAL) {
+        reads_ready = SIZE_MAX;
+        for (size_t i = 0; i < reads.size(); ++i)
+          reads_ready = std::min(reads_ready, reads[i].ready);
+      }
+    }
+    ++read_turn;
   }
 
-  if (in.b_valid && out.b_ready) {
-    write_acked = true;
-  }
+  if (in.b_valid && out.b_ready)
+    write_acks.pop_front();
+
+  if constexpr (!Timing::IDEAL)
+    ++cycle;
 }
 
-int main(int argc, char **argv) {
-  //===--------------------------------------------------------------------===//
-  // Process CLI arguments
-  //===--------------------------------------------------------------------===//
+/// Sparse memory of the simulated system, allocated in pages on first write.
+/// AXI bursts never cross a 4 KiB boundary, such that every burst maps to a
+/// contiguous span of host memory within a single page.
+class Memory {
+public:
+  static constexpr uint64_t PAGE_SIZE = 4096;
+  /// Content of memory that has never been written (`wfi` instructions).
+  static constexpr uint64_t UNMAPPED = 0x1050007310500073;
 
-  bool optRunAll = true;
-  bool optRunArcs = false;
-  bool optRunVtor = false;
-  char *optVcdOutputFile = nullptr;
+  /// Return the host memory backing `[addr, addr + num_bytes)`. Returns null
+  /// if the range crosses a page boundary, or if it is unmapped and
+  /// `allocate` is false.
+  uint8_t *span(uint64_t addr, size_t num_bytes, bool allocate) {
+    if (addr / PAGE_SIZE != (addr + num_bytes - 1) / PAGE_SIZE)
+      return nullptr;
+    auto *page = find_page(addr / PAGE_SIZE, allocate);
+    return page ? page + addr % PAGE_SIZE : nullptr;
+  }
 
-  char **argOut = argv + 1;
-  for (char **arg = argv + 1, **argEnd = argv + argc; arg != argEnd; ++arg) {
-    if (strcmp(*arg, "--arcs") == 0) {
-      optRunAll = false;
-      optRunArcs = true;
-      continue;
+  /// Read and write the 64 bit word containing `addr`. Writes only update the
+  /// bytes enabled in the write strobe `strb`.
+  uint64_t read64(uint64_t addr) {
+    auto *ptr = span(addr / 8 * 8, 8, false);
+    if (!ptr)
+      return UNMAPPED;
+    uint64_t data;
+    memcpy(&data, ptr, 8);
+    return data;
+  }
+  void write64(uint64_t addr, uint64_t data, uint8_t strb = 0xFF) {
+    auto *ptr = span(addr / 8 * 8, 8, true);
+    if (strb == 0xFF)
+      memcpy(ptr, &data, 8);
+    else
+      masked_merge(ptr, reinterpret_cast<const uint8_t *>(&data), &strb, 8);
+  }
+
+private:
+  std::unordered_map<uint64_t, std::unique_ptr<uint64_t[]>> pages;
+  uint64_t last_index = -1;
+  uint8_t *last_page = nullptr;
+
+  uint8_t *find_page(uint64_t index, bool allocate) {
+    if (index == last_index)
+      return last_page;
+    auto it = pages.find(index);
+    if (it == pages.end()) {
+      if (!allocate)
+        return nullptr;
+      auto page = std::make_unique<uint64_t[]>(PAGE_SIZE / 8);
+      std::fill_n(page.get(), PAGE_SIZE / 8, UNMAPPED);
+      it = pages.emplace(index, std::move(page)).first;
     }
-    if (strcmp(*arg, "--vtor") == 0) {
-      optRunAll = false;
-      optRunVtor = true;
+    last_index = index;
+    last_page = reinterpret_cast<uint8_t *>(it->second.get());
+    return last_page;
+  }
+};
+
+/// Addresses of the `tohost`/`fromhost` mailbox of hart 0. Further harts'
+/// mailboxes follow every `MAILBOX_SIZE` bytes.
+struct HostInterface {
+  uint64_t tohost = TOHOST_ADDR;
+  uint64_t fromhost = FROMHOST_ADDR;
+  uint64_t tohost_data = TOHOST_DATA_ADDR;
+  uint64_t tohost_stats = TOHOST_STATS_ADDR;
+  /// Number of harts the binary has a mailbox for, from the size of the
+  /// section holding `tohost`, or 0 if unknown. The runtime parks the harts
+  /// beyond these, so they never exit.
+  unsigned num_mailboxes = 0;
+};
+
+/// Resolve the host interface from the symbol table of `elf`. Symbols missing
+/// from the binary keep their offset from `tohost` in the default layout, and
+/// binaries without a `tohost` symbol use the default addresses.
+static HostInterface find_host_interface(const ELFIO::elfio &elf,
+                                         std::ostream &log) {
+  HostInterface host;
+  uint64_t *fields[] = {&host.tohost, &host.fromhost, &host.tohost_data,
+                        &host.tohost_stats};
+  const char *names[] = {"tohost", "fromhost", "tohost_data", "tohost_stats"};
+  bool found[4] = {};
+  for (const auto &section : elf.sections) {
+    if (section->get_type() != ELFIO::SHT_SYMTAB)
       continue;
-    }
-    if (strcmp(*arg, "--trace") == 0) {
-      ++arg;
-      if (arg == argEnd) {
-        std::cerr << "missing trace output file name after `--trace`\n";
-        return 1;
+    ELFIO::symbol_section_accessor symbols(elf, section.get());
+    for (unsigned i = 0; i < 4; ++i) {
+      ELFIO::Elf64_Addr value;
+      ELFIO::Elf_Xword size;
+      unsigned char bind, type, other;
+      ELFIO::Elf_Half section_index;
+      if (!found[i] && symbols.get_symbol(names[i], value, size, bind, type,
+                                          section_index, other)) {
+        *fields[i] = value;
+        found[i] = true;
+        if (i == 0 && section_index < elf.sections.size()) {
+          auto *mailboxes = elf.sections[section_index];
+          uint64_t end = mailboxes->get_address() + mailboxes->get_size();
+          if (end > value)
+            host.num_mailboxes =
+                (end - value + MAILBOX_SIZE - 1) / MAILBOX_SIZE;
+        }
       }
-      optVcdOutputFile = *arg;
+    }
+  }
+  if (!found[0])
+    return HostInterface();
+  for (unsigned i = 1; i < 4; ++i)
+    if (!found[i])
+      *fields[i] = host.tohost + (*fields[i] - TOHOST_ADDR);
+  if (host.tohost != TOHOST_ADDR)
+    log << std::hex << "tohost at " << host.tohost << ", fromhost at "
+        << host.fromhost << std::dec << "\n";
+  return host;
+}
+
+/// Load the segments of an ELF binary into memory, and locate its host
+/// interface.
+static bool load_binary(const char *path, Memory &memory, HostInterface &host,
+                        std::ostream &log) {
+  ELFIO::elfio elf;
+  if (!elf.load(path)) {
+    log << "unable to open file " << path << std::endl;
+    return false;
+  }
+  host = find_host_interface(elf, log);
+  uint64_t num_bytes = 0;
+  log << std::hex;
+  for (const auto &segment : elf.segments) {
+    if (segment->get_type() != ELFIO::PT_LOAD ||
+        segment->get_memory_size() == 0)
       continue;
+    log << "loading segment at " << segment->get_physical_address()
+        << " (virtual address " << segment->get_virtual_address() << ")\n";
+    // Copy the segment page by page, zero-filling beyond the file contents.
+    uint64_t mem_size = segment->get_memory_size();
+    uint64_t file_size = segment->get_file_size();
+    for (uint64_t i = 0; i < mem_size;) {
+      uint64_t addr = segment->get_physical_address() + i;
+      uint64_t chunk =
+          std::min(mem_size - i, Memory::PAGE_SIZE - addr % Memory::PAGE_SIZE);
+      uint64_t from_file = i < file_size ? std::min(chunk, file_size - i) : 0;
+      auto *dst = memory.span(addr, chunk, true);
+      memcpy(dst, segment->get_data() + i, from_file);
+      memset(dst + from_file, 0, chunk - from_file);
+      i += chunk;
     }
-    *argOut++ = *arg;
+    num_bytes += mem_size;
   }
-  argc = argOut - argv;
+  log << "entry " << elf.get_entry() << "\n";
+  log << std::dec;
+  log << "loaded " << num_bytes << " program bytes\n";
+  return true;
+}
 
-  if (argc != 2) {
-    std::cerr << "usage: " << argv[0] << " [options] <binary>\n";
-    std::cerr << "options:\n";
-    std::cerr << "  --arcs         run arcilator simulation\n";
-    std::cerr << "  --vtor         run verilator simulation\n";
-    std::cerr << "  --trace <VCD>  write trace to <VCD> file\n";
-    return 1;
+/// Bring freshly allocated models out of reset.
+static void reset_model(ComparingRocketModel &model) {
+  for (unsigned i = 0; i < 1000; ++i) {
+    model.set_reset(i < 100);
+    model.clock();
   }
+}
 
-  //===--------------------------------------------------------------------===//
-  // Read ELF into memory
-  //===--------------------------------------------------------------------===//
+/// Exit status and statistics of a single hart.
+struct HartResult {
+  bool finished = false;
+  uint64_t exit_code = 0;
+  /// Simulation cycle at which the hart exited.
+  size_t cycle = 0;
+  /// Counters reported by the guest on exit, zero if not reported.
+  uint64_t mcycle = 0;
+  uint64_t minstret = 0;
+};
 
-  std::map<uint64_t, uint64_t> memory;
-  {
-    ELFIO::elfio elf;
-    if (!elf.load(argv[1])) {
-      std::cerr << "unable to open file " << argv[1] << std::endl;
-      return 1;
+/// Outcome of running a binary on a model.
+struct RunResult {
+  /// Whether all harts have exited.
+  bool finished = false;
+  bool mismatch = false;
+  unsigned num_harts = 1;
+  HartResult harts[MAX_HARTS];
+
+  bool succeeded() const {
+    if (!finished || mismatch)
+      return false;
+    for (unsigned i = 0; i < num_harts; ++i)
+      if (harts[i].exit_code != 0)
+        return false;
+    return true;
+  }
+};
+
+static void print_hart_stats(const RunResult &result, std::ostream &os) {
+  for (unsigned i = 0; i < result.num_harts; ++i) {
+    auto &hart = result.harts[i];
+    os << "hart " << i << ": ";
+    if (!hart.finished) {
+      os << "did not exit\n";
+      continue;
     }
-    std::cerr << std::hex;
-    for (const auto &segment : elf.segments) {
-      if (segment->get_type() != ELFIO::PT_LOAD ||
-          segment->get_memory_size() == 0)
+    os << "exit code " << hart.exit_code << " at cycle " << hart.cycle;
+    if (hart.mcycle != 0)
+      os << ", " << hart.minstret << " instructions retired in "
+         << hart.mcycle << " cycles (IPC "
+         << (static_cast<double>(hart.minstret) / hart.mcycle) << ")";
+    os << "\n";
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// MMIO Devices
+//===----------------------------------------------------------------------===//
+
+/// A device on the MMIO port. Accesses are passed as 64 bit words at offsets
+/// relative to the base address of the device, aligned to 8 bytes, with writes
+/// carrying the AXI write strobe.
+class MmioDevice {
+public:
+  virtual ~MmioDevice() {}
+  virtual uint64_t read(uint64_t offset) = 0;
+  virtual void write(uint64_t offset, uint64_t data, uint8_t strb) = 0;
+};
+
+/// Address decoder of the MMIO port. Devices are kept in a table sorted by
+/// base address and looked up by binary search. Accesses to unmapped addresses
+/// read as zero and drop writes.
+class MmioBus {
+public:
+  /// Map `device` at `[base, base + size)`. Returns false if the range
+  /// overlaps an already mapped device.
+  bool map(uint64_t base, uint64_t size, MmioDevice &device) {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), base,
+                               [](uint64_t addr, const Range &range) {
+                                 return addr < range.base;
+                               });
+    if (it != ranges.end() && it->base < base + size)
+      return false;
+    if (it != ranges.begin() && base < (it - 1)->base + (it - 1)->size)
+      return false;
+    last = ranges.insert(it, {base, size, &device}) - ranges.begin();
+    return true;
+  }
+
+  uint64_t read(uint64_t addr) {
+    auto *range = find(addr);
+    return range ? range->device->read(addr / 8 * 8 - range->base) : 0;
+  }
+
+  void write(uint64_t addr, uint64_t data, uint8_t strb) {
+    if (auto *range = find(addr))
+      range->device->write(addr / 8 * 8 - range->base, data, strb);
+  }
+
+private:
+  struct Range {
+    uint64_t base;
+    uint64_t size;
+    MmioDevice *device;
+  };
+  std::vector<Range> ranges;
+  /// Index of the most recently accessed range.
+  size_t last = 0;
+
+  const Range *find(uint64_t addr) {
+    // Guests tend to access the same device many times in a row, for example
+    // when polling `fromhost`, so try the previous hit first.
+    if (last < ranges.size() && addr - ranges[last].base < ranges[last].size)
+      return &ranges[last];
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), addr,
+                               [](uint64_t addr, const Range &range) {
+                                 return addr < range.base;
+                               });
+    if (it == ranges.begin() || addr - (it - 1)->base >= (it - 1)->size)
+      return nullptr;
+    last = it - 1 - ranges.begin();
+    return &ranges[last];
+  }
+};
+
+/// Records harts exiting into a `RunResult` and announces the outcome once
+/// all harts have exited.
+class HartExits {
+public:
+  HartExits(RunResult &result, std::ostream &console, const size_t &cycle)
+      : result(result), console(console), cycle(cycle) {}
+
+  void exit(unsigned hart, uint64_t exit_code, uint64_t mcycle = 0,
+            uint64_t minstret = 0) {
+    if (hart >= result.num_harts)
+      return;
+    auto &hart_result = result.harts[hart];
+    if (hart_result.finished)
+      return;
+    hart_result.finished = true;
+    hart_result.exit_code = exit_code;
+    hart_result.cycle = cycle;
+    hart_result.mcycle = mcycle;
+    hart_result.minstret = minstret;
+    if (++num_finished < result.num_harts)
+      return;
+    result.finished = true;
+    if (result.succeeded())
+      console << "Benchmark run successful!\n";
+    for (unsigned i = 0; i < result.num_harts; ++i) {
+      if (result.harts[i].exit_code == 0)
         continue;
-      std::cerr << "loading segment at " << segment->get_physical_address()
-                << " (virtual address " << segment->get_virtual_address()
-                << ")\n";
-      for (unsigned i = 0; i < segment->get_memory_size(); ++i) {
-        uint64_t addr = segment->get_physical_address() + i;
-        uint8_t data = 0;
-        if (i < segment->get_file_size())
-          data = segment->get_data()[i];
-        auto &slot = memory[addr / 8 * 8];
-        slot &= ~((uint64_t)0xFF << ((addr % 8) * 8));
-        slot |= (uint64_t)data << ((addr % 8) * 8);
-      }
+      console << "Benchmark failed with exit code "
+              << result.harts[i].exit_code;
+      if (result.num_harts > 1)
+        console << " on hart " << i;
+      console << "\n";
     }
-    std::cerr << "entry " << elf.get_entry() << "\n";
-    std::cerr << std::dec;
-    std::cerr << "loaded " << memory.size() * 8 << " program bytes\n";
   }
 
-  // Allocate the simulation models.
-  ComparingRocketModel model;
-  if (optRunAll || optRunVtor)
-    model.models.push_back(makeVerilatorModel());
-  if (optRunAll || optRunArcs)
-    model.models.push_back(makeArcilatorModel());
-  if (optVcdOutputFile)
-    model.vcd_start(optVcdOutputFile);
+private:
+  RunResult &result;
+  std::ostream &console;
+  const size_t &cycle;
+  unsigned num_finished = 0;
+};
 
-  //===--------------------------------------------------------------------===//
-  // Model initialization and reset
-  //===--------------------------------------------------------------------===//
+/// The `tohost`/`fromhost` mailboxes of all harts, laid out as described by
+/// the binary's `HostInterface`. Writing `tohost` either exits the hart or
+/// performs a system call; `fromhost` always reads as non-zero to acknowledge.
+class HostMailbox : public MmioDevice {
+public:
+  HostMailbox(const HostInterface &host, unsigned num_harts, HartExits &exits,
+              std::ostream &console)
+      : num_harts(num_harts), exits(exits), console(console),
+        lines(num_harts) {
+    start = std::min({host.tohost, host.fromhost, host.tohost_data,
+                      host.tohost_stats}) / 8 * 8;
+    uint64_t end = std::max({host.tohost + 8, host.fromhost + 8,
+                             host.tohost_data + TOHOST_DATA_SIZE,
+                             host.tohost_stats + 16});
+    tohost = host.tohost - start;
+    fromhost = host.fromhost - start;
+    tohost_data = host.tohost_data - start;
+    tohost_stats = host.tohost_stats - start;
+    words.resize((end - start + 7) / 8 + (num_harts - 1) * MAILBOX_SIZE / 8);
+  }
 
-  for (unsigned i = 0; i < 1000; ++i) {
-    model.set_reset(i < 100);
-    model.clock();
+  uint64_t base() const { return start; }
+  uint64_t size() const { return words.size() * 8; }
+
+  uint64_t read(uint64_t offset) override {
+    // Core loops on condition fromhost=0, thus set it to something non-zero.
+    if (offset >= fromhost && (offset - fromhost) % MAILBOX_SIZE == 0)
+      return -1;
+    return 0;
   }
 
-  //===--------------------------------------------------------------------===//
-  // Simulation loop
-  //===--------------------------------------------------------------------===//
+  void write(uint64_t offset, uint64_t data, uint8_t strb) override {
+    auto &word = words[offset / 8];
+    word ^= (word ^ data) & strb_byte_mask(strb);
 
-  AxiPort mem_port;
-  mem_port.readFn = [&](size_t addr, size_t &data) {
-    auto it = memory.find(addr / 8 * 8);
-    if (it != memory.end())
-      data = it->second;
-    else
-      data = 0x1050007310500073;
-  };
-  mem_port.writeFn = [&](size_t addr, size_t data, size_t mask) {
-    assert(mask == 0xFF && "only full 64 bit write supported");
-    memory[addr / 8 * 8] = data;
-  };
+    // Act on `tohost` once its lowest byte is written, such that narrow stores
+    // see the complete value.
+    if (offset < tohost || (offset - tohost) % MAILBOX_SIZE != 0 ||
+        !(strb & 1))
+      return;
+    unsigned hart = (offset - tohost) / MAILBOX_SIZE;
+    uint64_t mailbox = hart * MAILBOX_SIZE;
+    data = word;
 
+    // On exit, the return code shifted left by one and with the lowest bit set
+    // is written to tohost. A zero return code thus writes 1.
+    if (data & 1) {
+      exits.exit(hart, data >> 1, read_word(tohost_stats + mailbox),
+                 read_word(tohost_stats + mailbox + 8));
+      return;
+    }
 
-  AxiPort mmio_port;
-  mmio_port.writeFn = [&](size_t addr, size_t data, size_t mask) {
-    assert(mask == 0xFF && "only full 64 bit write supported");
-    memory[addr / 8 * 8] = data;
-
-    // For a zero return code from the main function, 1 is written to tohost.
-    if (addr == TOHOST_ADDR) {
-      if (data == 1) {
-        finished = true;
-        std::cout << "Benchmark run successful!\n";
-        return;
-      }
-
-      if (data == SYS_write) {
-        for (int i = 0; i < TOHOST_DATA_SIZE; i += 8) {
-          uint64_t data = memory[TOHOST_DATA_ADDR + i];
-          unsigned char c[8];
-          *(uint64_t*) c = data;
-          for (int k = 0; k < 8; ++k) {
-            std::cout << c[k];
-            if ((unsigned char) c[k] == 0)
-              return;
-          }
+    if (data == SYS_write) {
+      for (int i = 0; i < TOHOST_DATA_SIZE; ++i) {
+        char c = read_word(tohost_data + mailbox + i) >>
+                 ((tohost_data + mailbox + i) % 8 * 8);
+        if (c == 0)
+          return;
+        if (num_harts == 1) {
+          console << c;
+        } else if (c == '\n') {
+          console << "[hart " << hart << "] " << lines[hart] << "\n";
+          lines[hart].clear();
+        } else {
+          lines[hart] += c;
         }
       }
     }
-  };
-  mmio_port.readFn = [&](size_t addr, size_t &data) {
-    // Core loops on condition fromhost=0, thus set it to something non-zero.
-    if (addr == FROMHOST_ADDR)
-      data = -1;
-  };
+  }
 
-  size_t num_bad_cycles = 0;
-  for (unsigned i = 0; i < 1000000; ++i) {
-    mem_port.out = model.get_mem();
-    mem_port.update_a();
-    model.set_mem(mem_port.in);
+  /// Print lines left unterminated when the run ends.
+  void flush() {
+    for (unsigned hart = 0; hart < num_harts; ++hart)
+      if (!lines[hart].empty())
+        console << "[hart " << hart << "] " << lines[hart] << "\n";
+  }
 
-    mmio_port.out = model.get_mmio();
-    mmio_port.update_a();
-    model.set_mmio(mmio_port.in);
+private:
+  unsigned num_harts;
+  HartExits &exits;
+  std::ostream &console;
+  /// Base address of the device and offsets of the fields of hart 0.
+  uint64_t start, tohost, fromhost, tohost_data, tohost_stats;
+  std::vector<uint64_t> words;
+  std::vector<std::string> lines;
 
-    model.eval();
+  uint64_t read_word(uint64_t offset) const {
+    return offset / 8 < words.size() ? words[offset / 8] : 0;
+  }
+};
 
-    mem_port.out = model.get_mem();
-    mem_port.update_b();
-    model.set_mem(mem_port.in);
+/// Console UART with the register layout of the SiFive UART. Bytes written to
+/// `txdata` are printed right away; the receive queue is always empty.
+class Uart : public MmioDevice {
+public:
+  static constexpr uint64_t SIZE = 0x1000;
 
-    mmio_port.out = model.get_mmio();
-    mmio_port.update_b();
-    model.set_mmio(mmio_port.in);
+  Uart(std::ostream &console) : console(console) {}
 
-    model.clock();
+  uint64_t read(uint64_t offset) override {
+    // `txdata` at 0x0 reads as not full, `rxdata` at 0x4 as empty.
+    return offset == 0 ? uint64_t(1) << 63 : 0;
+  }
 
-    if (finished)
-      return 0;
+  void write(uint64_t offset, uint64_t data, uint8_t strb) override {
+    if (offset == 0 && (strb & 1))
+      console << static_cast<char>(data);
+  }
 
-    if (model.num_mismatches > 0) {
-      if (++num_bad_cycles >= 3) {
-        std::cerr << "aborting due to port mismatches\n";
-        return 1;
-      }
+private:
+  std::ostream &console;
+};
+
+/// Timer with the register layout of the RISC-V CLINT, counting simulation
+/// cycles in `mtime`. The testbench cannot raise interrupts in the model, so
+/// guests have to poll `mtime` against their deadline.
+class Timer : public MmioDevice {
+public:
+  static constexpr uint64_t SIZE = 0x10000;
+  static constexpr uint64_t MSIP = 0x0000;
+  static constexpr uint64_t MTIMECMP = 0x4000;
+  static constexpr uint64_t MTIME = 0xBFF8;
+
+  Timer(const size_t &cycle) : cycle(cycle) {}
+
+  uint64_t read(uint64_t offset) override {
+    if (offset == MTIME)
+      return cycle + mtime_offset;
+    if (offset >= MTIMECMP && offset < MTIMECMP + MAX_HARTS * 8)
+      return mtimecmp[(offset - MTIMECMP) / 8];
+    if (offset < MAX_HARTS * 4)
+      return uint64_t(msip[offset / 4 + 1]) << 32 | msip[offset / 4];
+    return 0;
+  }
+
+  void write(uint64_t offset, uint64_t data, uint8_t strb) override {
+    uint64_t mask = strb_byte_mask(strb);
+    if (offset == MTIME) {
+      uint64_t mtime = cycle + mtime_offset;
+      mtime ^= (mtime ^ data) & mask;
+      mtime_offset = mtime - cycle;
+    } else if (offset >= MTIMECMP && offset < MTIMECMP + MAX_HARTS * 8) {
+      auto &cmp = mtimecmp[(offset - MTIMECMP) / 8];
+      cmp ^= (cmp ^ data) & mask;
+    } else if (offset < MAX_HARTS * 4) {
+      if (strb & 0x0F)
+        msip[offset / 4] = data & 1;
+      if (strb & 0xF0)
+        msip[offset / 4 + 1] = data >> 32 & 1;
     }
   }
 
+private:
+  const size_t &cycle;
+  uint64_t mtime_offset = 0;
+  uint64_t mtimecmp[MAX_HARTS] = {};
+  uint32_t msip[MAX_HARTS] = {};
+};
+
+/// Simulation control for guests that do not use the mailbox protocol. Each
+/// hart owns two registers at `hart * 16`: writing the exit code to the first
+/// ends the hart, and writing the second logs a marker with the simulation
+/// cycle, to delimit regions of interest.
+class MagicDevice : public MmioDevice {
+public:
+  static constexpr uint64_t SIZE = MAX_HARTS * 16;
+
+  MagicDevice(HartExits &exits, std::ostream &log, const size_t &cycle)
+      : exits(exits), log(log), cycle(cycle) {}
+
+  uint64_t read(uint64_t offset) override { return 0; }
+
+  void write(uint64_t offset, uint64_t data, uint8_t strb) override {
+    unsigned hart = offset / 16;
+    if (offset % 16 == 0)
+      exits.exit(hart, data & strb_byte_mask(strb));
+    else
+      log << "hart " << hart << ": marker " << (data & strb_byte_mask(strb))
+          << " at cycle " << cycle << "\n";
+  }
+
+private:
+  HartExits &exits;
+  std::ostream &log;
+  const size_t &cycle;
+};
+
+/// A counter in the model state. Rocket Chip's `WideCounter` splits counters
+/// into a small register incremented every cycle and a large register holding
+/// the upper bits, which are combined here.
+struct CounterRef {
+  StateRef lo, hi;
+
+  uint64_t read() const {
+    uint64_t value = lo.peek();
+    if (hi)
+      value += hi.peek() << lo.state().num_bits;
+    return value;
+  }
+};
+
+/// Resolve a counter given as `<lo>[,<hi>]` state name suffixes to one
+/// counter per matching core. Returns an empty list if the states are missing.
+static std::vector<CounterRef> find_counters(const StateFile &state_file,
+                                             uint8_t *storage,
+                                             const std::string &spec) {
+  auto comma = spec.find(',');
+  auto los = state_file.find_suffix(spec.substr(0, comma));
+  std::vector<const StateInfo *> his;
+  if (comma != std::string::npos) {
+    his = state_file.find_suffix(spec.substr(comma + 1));
+    if (his.size() != los.size())
+      return {};
+  }
+  std::vector<CounterRef> counters;
+  for (unsigned i = 0; i < los.size(); ++i) {
+    CounterRef counter;
+    counter.lo = StateRef(storage, los[i]);
+    if (!his.empty())
+      counter.hi = StateRef(storage, his[i]);
+    counters.push_back(counter);
+  }
+  return counters;
+}
+
+/// Samples the retired instruction and cycle counters of every core directly
+/// from the model state, and reports the simulated IPC and the retired
+/// instructions per host second.
+class PerfSampler {
+public:
+  /// Candidate instret and cycle counters, covering the register names of the
+  /// different Rocket Chip versions.
+  static constexpr const char *DEFAULT_INSTRET[] = {"csr/small,csr/large",
+                                                    "csr/value_lo,csr/value_hi"};
+  static constexpr const char *DEFAULT_CYCLE[] = {"csr/small_1,csr/large_1",
+                                                  "csr/value_lo_1,csr/value_hi_1"};
+
+  bool bind(const StateFile &state_file, uint8_t *storage,
+            const std::string &instret_spec, const std::string &cycle_spec) {
+    instret = resolve(state_file, storage, instret_spec, DEFAULT_INSTRET);
+    cycle = resolve(state_file, storage, cycle_spec, DEFAULT_CYCLE);
+    if (instret.empty() || instret.size() != cycle.size())
+      return false;
+    start.resize(instret.size());
+    last.resize(instret.size());
+    for (unsigned i = 0; i < instret.size(); ++i)
+      start[i] = last[i] = {instret[i].read(), cycle[i].read()};
+    t_start = t_last = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  /// Print the progress of every core since the previous sample.
+  void sample(size_t sim_cycle, std::ostream &os) {
+    auto t_now = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < instret.size(); ++i) {
+      Sample now = {instret[i].read(), cycle[i].read()};
+      os << "cycle " << sim_cycle << ": core " << i << ": ";
+      report(os, now.instret, now.instret - last[i].instret,
+             now.cycle - last[i].cycle, t_now - t_last);
+      last[i] = now;
+    }
+    t_last = t_now;
+  }
+
+  /// Print the overall statistics of every core.
+  void summary(std::ostream &os) {
+    auto t_now = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < instret.size(); ++i) {
+      Sample now = {instret[i].read(), cycle[i].read()};
+      os << "core " << i << ": ";
+      report(os, now.instret - start[i].instret, now.instret - start[i].instret,
+             now.cycle - start[i].cycle, t_now - t_start);
+    }
+  }
+
+  /// Resolve the counter given by `spec`, or the first of `defaults` present
+  /// in the state file if `spec` is empty.
+  template <size_t N>
+  static std::vector<CounterRef> resolve(const StateFile &state_file,
+                                         uint8_t *storage,
+                                         const std::string &spec,
+                                         const char *const (&defaults)[N]) {
+    if (!spec.empty())
+      return find_counters(state_file, storage, spec);
+    for (auto *candidate : defaults)
+      if (auto counters = find_counters(state_file, storage, candidate);
+          !counters.empty())
+        return counters;
+    return {};
+  }
+
+private:
+  struct Sample {
+    uint64_t instret;
+    uint64_t cycle;
+  };
+  std::vector<CounterRef> instret, cycle;
+  std::vector<Sample> start, last;
+  std::chrono::steady_clock::time_point t_start, t_last;
+
+  static void report(std::ostream &os, uint64_t instret, uint64_t d_instret,
+                     uint64_t d_cycle, std::chrono::steady_clock::duration dt) {
+    auto seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(dt).count();
+    os << instret << " instret, IPC "
+       << (d_cycle ? static_cast<double>(d_instret) / d_cycle : 0.0) << ", "
+       << (d_instret / seconds / 1e6) << " MIPS\n";
+  }
+};
+
+/// Detects cores parked in `wfi` or otherwise stalled: no core retires an
+/// instruction and no AXI transaction is requested or in flight for a number
+/// of cycles. Only the design itself can wake a parked core, for example
+/// through a timer interrupt, so the testbench clocks a parked model in bursts
+/// in which it only watches the valid signals of the ports.
+class IdleDetector {
+public:
+  bool bind(const StateFile &state_file, uint8_t *storage,
+            const std::string &instret_spec, size_t threshold) {
+    instret = PerfSampler::resolve(state_file, storage, instret_spec,
+                                   PerfSampler::DEFAULT_INSTRET);
+    last.resize(instret.size());
+    this->threshold = threshold;
+    return !instret.empty();
+  }
+
+  /// Record the activity of the cycle that just elapsed.
+  void update(bool ports_quiet) {
+    bool retired = false;
+    for (unsigned i = 0; i < instret.size(); ++i) {
+      uint64_t now = instret[i].read();
+      retired |= now != last[i];
+      last[i] = now;
+    }
+    quiet_cycles = ports_quiet && !retired ? quiet_cycles + 1 : 0;
+  }
+
+  bool parked() const { return quiet_cycles >= threshold; }
+
+  /// Number of cycles fast-forwarded while parked.
+  size_t num_skipped = 0;
+
+private:
+  std::vector<CounterRef> instret;
+  std::vector<uint64_t> last;
+  size_t threshold = 0;
+  size_t quiet_cycles = 0;
+};
+
+/// Number of the valid and ready signals of an AXI port.
+#define HANDSHAKE_BITS 5
+/// Mask of the valid signals in `handshake_bits`, for both ports.
+#define VALID_BITS (0b00111 | 0b00111 << HANDSHAKE_BITS)
+/// Maximum number of cycles to fast-forward at once while the cores are
+/// parked, before checking whether they retired instructions.
+#define PARKED_BURST_CYCLES 64
+
+/// Pack the valid and ready signals driven by the model into a bitset.
+static inline unsigned handshake_bits(const AxiOutputs &out) {
+  return out.ar_valid | out.aw_valid << 1 | out.w_valid << 2 |
+         out.r_ready << 3 | out.b_ready << 4;
+}
+
+/// Settings that apply to every binary run.
+struct RunOptions {
+  /// Number of harts to wait for.
+  unsigned num_harts = 1;
+  /// Sample the core counters every this many cycles, or never if zero.
+  size_t stats_interval = 0;
+  /// State file to locate the core counters in the model storage.
+  const StateFile *state_file = nullptr;
+  /// Counter states as `<lo>[,<hi>]` name suffixes; empty to search for
+  /// the Rocket Chip defaults.
+  std::string instret_counter;
+  std::string cycle_counter;
+  /// Maximum number of outstanding read and write bursts on the memory port.
+  /// One serializes the bursts, as the testbench always did.
+  unsigned axi_outstanding = 1;
+  /// Interleave read responses with different IDs on the memory port.
+  bool axi_interleave = false;
+  /// Timing model of the memory behind the memory port.
+  enum { MEM_IDEAL, MEM_FIXED, MEM_BANKED } mem_timing = MEM_IDEAL;
+  /// Cycles from accepting a burst to its first beat for `MEM_FIXED`.
+  unsigned mem_latency = 20;
+  /// Fast-forward through cycles once the cores have been idle for this many
+  /// cycles, or never if zero.
+  size_t idle_cycles = 0;
+  /// Give up on the binary after this many cycles.
+  size_t max_cycles = MAX_CYCLES;
+};
+
+/// Run the binary loaded into `memory` on the model until all harts signal
+/// completion through their `tohost`, the models diverge, or
+/// `options.max_cycles` elapse, with the memory port answering according to
+/// `timing`. Guest console output is written to `console`, with each line
+/// prefixed by the hart if there are multiple. Statistics go to `log`.
+template <typename MemTiming>
+static RunResult run_binary(ComparingRocketModel &model, Memory &memory,
+                            const HostInterface &host,
+                            const RunOptions &options, MemTiming timing,
+                            std::ostream &console, std::ostream &log) {
+  unsigned num_harts = options.num_harts;
+  if (host.num_mailboxes > 0 && host.num_mailboxes < num_harts) {
+    log << "binary only has mailboxes for " << host.num_mailboxes
+        << " hart(s), not waiting for the others\n";
+    num_harts = host.num_mailboxes;
+  }
+  RunResult result;
+  result.num_harts = num_harts;
+
+  AxiPort<MemTiming> mem_port;
+  mem_port.timing = timing;
+  mem_port.max_outstanding = options.axi_outstanding;
+  mem_port.interleave = options.axi_interleave;
+  mem_port.spanFn = [&](size_t addr, size_t num_bytes, bool write) {
+    return memory.span(addr, num_bytes, write);
+  };
+  mem_port.readFn = [&](size_t addr, size_t &data) {
+    data = memory.read64(addr);
+  };
+  mem_port.writeFn = [&](size_t addr, size_t data, size_t mask) {
+    memory.write64(addr, data, mask);
+  };
+
+  HartExits exits(result, console, model.cycle);
+  HostMailbox mailbox(host, num_harts, exits, console);
+  Uart uart(console);
+  Timer timer(model.cycle);
+  MagicDevice magic(exits, log, model.cycle);
+  MmioBus bus;
+  if (!bus.map(mailbox.base(), mailbox.size(), mailbox))
+    log << std::hex << "host interface at " << mailbox.base()
+        << " overlaps a testbench device\n"
+        << std::dec;
+  bus.map(UART_ADDR, Uart::SIZE, uart);
+  bus.map(TIMER_ADDR, Timer::SIZE, timer);
+  bus.map(MAGIC_ADDR, MagicDevice::SIZE, magic);
+
+  AxiPort<> mmio_port;
+  mmio_port.writeFn = [&](size_t addr, size_t data, size_t mask) {
+    bus.write(addr, data, mask);
+  };
+  mmio_port.readFn = [&](size_t addr, size_t &data) { data = bus.read(addr); };
+
+  // Bind to the core counters in the model state if requested.
+  PerfSampler sampler;
+  bool sampling = false;
+  if (options.stats_interval > 0) {
+    if (!options.state_file || !model.get_storage())
+      log << "no arcilator state available, not sampling counters\n";
+    else if (!(sampling = sampler.bind(*options.state_file, model.get_storage(),
+                                       options.instret_counter,
+                                       options.cycle_counter)))
+      log << "core counters not found in the state file, not sampling\n";
+  }
+
+  // Watch for parked cores if requested.
+  IdleDetector idle;
+  bool detect_idle = false;
+  if (options.idle_cycles > 0) {
+    if (!options.state_file || !model.get_storage())
+      log << "no arcilator state available, not detecting parked cores\n";
+    else if (!(detect_idle = idle.bind(*options.state_file,
+                                       model.get_storage(),
+                                       options.instret_counter,
+                                       options.idle_cycles)))
+      log << "instret counter not found in the state file, not detecting "
+             "parked cores\n";
+  }
+
+  unsigned last_handshake = 0;
+  bool was_quiet = false;
+  size_t num_bad_cycles = 0;
+  for (size_t i = 0; i < options.max_cycles; ++i) {
+    // Clock parked models in bursts, stopping at the next counter sample. The
+    // ports stay live: with no transaction in flight, their inputs only change
+    // once the model raises a valid signal, which ends the burst before the
+    // next port update. Only the host-side work of the skipped cycles and the
+    // per-cycle idle bookkeeping are saved, so results stay cycle-exact.
+    if (detect_idle && idle.parked()) {
+      size_t n = std::min<size_t>(PARKED_BURST_CYCLES, options.max_cycles - i);
+      if (sampling)
+        n = std::min(n, options.stats_interval - i % options.stats_interval);
+      size_t num_clocked = 0;
+      bool woken = false;
+      while (num_clocked < n && !woken && model.num_mismatches == 0) {
+        model.clock();
+        ++num_clocked;
+        woken = ((handshake_bits(model.get_mem()) |
+                  handshake_bits(model.get_mmio()) << HANDSHAKE_BITS) &
+                 VALID_BITS) != 0;
+      }
+      mem_port.skip_cycles(num_clocked);
+      mmio_port.skip_cycles(num_clocked);
+      idle.num_skipped += num_clocked;
+      i += num_clocked - 1;
+      idle.update(!woken);
+      was_quiet = false;
+      if (sampling && (i + 1) % options.stats_interval == 0)
+        sampler.sample(model.cycle, log);
+      if (model.num_mismatches > 0 && ++num_bad_cycles >= 3) {
+        result.mismatch = true;
+        break;
+      }
+      continue;
+    }
+
+    // Skip the port updates while no transaction is requested or in flight and
+    // the handshake signals are unchanged. The port inputs then stay the same,
+    // so evaluating the model before the clock edge would not change anything
+    // either.
+    auto mem_out = model.get_mem();
+    auto mmio_out = model.get_mmio();
+    unsigned handshake = handshake_bits(mem_out) |
+                         handshake_bits(mmio_out) << HANDSHAKE_BITS;
+    bool quiet = (handshake & VALID_BITS) == 0 && mem_port.idle() &&
+                 mmio_port.idle();
+    bool skip = quiet && was_quiet && handshake == last_handshake;
+    was_quiet = quiet;
+    last_handshake = handshake;
+
+    if (skip) {
+      mem_port.skip_cycles();
+      mmio_port.skip_cycles();
+    } else {
+      mem_port.out = mem_out;
+      mem_port.update_a();
+      model.set_mem(mem_port.in);
+
+      mmio_port.out = mmio_out;
+      mmio_port.update_a();
+      model.set_mmio(mmio_port.in);
+
+      model.eval();
+
+      mem_port.out = model.get_mem();
+      mem_port.update_b();
+      model.set_mem(mem_port.in);
+
+      mmio_port.out = model.get_mmio();
+      mmio_port.update_b();
+      model.set_mmio(mmio_port.in);
+    }
+
+    model.clock();
+
+    if (detect_idle)
+      idle.update(quiet);
+
+    if (sampling && (i + 1) % options.stats_interval == 0)
+      sampler.sample(model.cycle, log);
+
+    if (result.finished)
+      break;
+
+    if (model.num_mismatches > 0) {
+      if (++num_bad_cycles >= 3) {
+        result.mismatch = true;
+        break;
+      }
+    }
+  }
+
+  mailbox.flush();
+  if (sampling)
+    sampler.summary(log);
+  if (idle.num_skipped > 0)
+    log << idle.num_skipped << " idle cycles fast-forwarded\n";
+  return result;
+}
+
+/// Run the binary with the memory timing model selected in `options`. Each
+/// model gets its own instance of the simulation loop, such that the ideal
+/// memory carries no timing overhead.
+static RunResult run_binary(ComparingRocketModel &model, Memory &memory,
+                            const HostInterface &host,
+                            const RunOptions &options, std::ostream &console,
+                            std::ostream &log) {
+  switch (options.mem_timing) {
+  case RunOptions::MEM_FIXED: {
+    FixedLatencyTiming timing;
+    timing.latency = options.mem_latency;
+    return run_binary(model, memory, host, options, timing, console, log);
+  }
+  case RunOptions::MEM_BANKED:
+    return run_binary(model, memory, host, options, BankedTiming(), console,
+                      log);
+  default:
+    return run_binary(model, memory, host, options, IdealTiming(), console,
+                      log);
+  }
+}
+
+/// Print the value of a state in the model storage. States are given as
+/// `<path>`, or `<path>[<index>]` to select a word of a memory.
+static bool print_state(const StateFile &state_file, uint8_t *storage,
+                        const std::string &spec, std::ostream &os) {
+  std::string path = spec;
+  size_t index = 0;
+  if (auto bracket = spec.find('['); bracket != std::string::npos) {
+    path = spec.substr(0, bracket);
+    index = strtoull(spec.c_str() + bracket + 1, nullptr, 0);
+  }
+  auto *info = state_file.find(path);
+  if (!info) {
+    os << "unknown state `" << path << "`\n";
+    return false;
+  }
+  if (info->type == StateInfo::MEMORY && index >= info->depth) {
+    os << "index " << index << " out of bounds for memory `" << path
+       << "` of depth " << info->depth << "\n";
+    return false;
+  }
+  StateRef ref(storage, info);
+  os << spec << " = 0x" << std::hex;
+  if (info->num_bits <= 64) {
+    os << ref.peek(index);
+  } else {
+    std::vector<uint8_t> bytes(info->num_bytes());
+    ref.peek_bytes(bytes.data(), index);
+    for (size_t i = bytes.size(); i-- > 0;)
+      os << (bytes[i] >> 4) << (bytes[i] & 0xF);
+  }
+  os << std::dec << " (" << info->num_bits << " bits)\n";
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Batch Mode
+//===----------------------------------------------------------------------===//
+
+/// A fixed set of worker threads, each pinned to a core. Every worker owns a
+/// queue of job indices which it drains from the back; once its own queue is
+/// empty it steals from the front of the other workers' queues.
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(unsigned num_workers) : queues(num_workers) {}
+
+  /// Call `fn` for every index in `[0, num_jobs)` and wait for completion.
+  void run(size_t num_jobs, const std::function<void(size_t)> &fn) {
+    for (size_t i = 0; i < num_jobs; ++i)
+      queues[i % queues.size()].jobs.push_back(i);
+    std::vector<std::thread> threads;
+    for (unsigned worker = 0; worker < queues.size(); ++worker)
+      threads.emplace_back([this, worker, &fn] { work(worker, fn); });
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+  };
+  std::vector<Queue> queues;
+
+  void work(unsigned worker, const std::function<void(size_t)> &fn) {
+    pin_to_core(worker);
+    size_t job;
+    while (pop(worker, job) || steal(worker, job))
+      fn(job);
+  }
+
+  bool pop(unsigned worker, size_t &job) {
+    auto &queue = queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+      return false;
+    job = queue.jobs.back();
+    queue.jobs.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned worker, size_t &job) {
+    for (unsigned i = 1; i < queues.size(); ++i) {
+      auto &queue = queues[(worker + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.jobs.empty())
+        continue;
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  static void pin_to_core(unsigned worker) {
+#ifdef __linux__
+    unsigned num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(worker % num_cores, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+  }
+};
+
+/// Simulate each binary on its own Arcilator model, distributing the models
+/// across `num_workers` threads. Every model is allocated on the thread that
+/// runs it such that its storage is local to the pinned core.
+static int run_batch(const std::vector<const char *> &binaries,
+                     unsigned num_workers, const RunOptions &options) {
+  struct Job {
+    const char *binary;
+    bool loaded = false;
+    RunResult result;
+    size_t cycles = 0;
+    double seconds = 0;
+  };
+  std::vector<Job> jobs;
+  for (auto *binary : binaries)
+    jobs.push_back({binary});
+
+  std::mutex output_mutex;
+  auto t_start = std::chrono::high_resolution_clock::now();
+  WorkStealingPool pool(num_workers);
+  pool.run(jobs.size(), [&](size_t idx) {
+    auto &job = jobs[idx];
+    std::ostringstream output;
+    Memory memory;
+    HostInterface host;
+    job.loaded = load_binary(job.binary, memory, host, output);
+    if (job.loaded) {
+      ComparingRocketModel model;
+      model.quiet = true;
+      model.models.push_back(makeArcilatorModel());
+      reset_model(model);
+      job.result = run_binary(model, memory, host, options, output, output);
+      print_hart_stats(job.result, output);
+      job.cycles = model.cycle;
+      job.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                        model.models[0]->duration)
+                        .count();
+    }
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::cout << "----- job " << idx << ": " << job.binary << " -----\n"
+              << output.str() << std::flush;
+  });
+  auto t_end = std::chrono::high_resolution_clock::now();
+  auto wall_seconds =
+      std::chrono::duration_cast<std::chrono::duration<double>>(t_end -
+                                                                t_start)
+          .count();
+
+  size_t total_cycles = 0;
+  unsigned num_failed = 0;
+  std::cerr << "----------------------------------------\n";
+  for (unsigned idx = 0; idx < jobs.size(); ++idx) {
+    auto &job = jobs[idx];
+    total_cycles += job.cycles;
+    const char *status = "finished";
+    if (!job.loaded)
+      status = "load failed";
+    else if (!job.result.finished)
+      status = "timeout";
+    else if (!job.result.succeeded())
+      status = "failed";
+    if (!job.loaded || !job.result.succeeded())
+      ++num_failed;
+    std::cerr << "job " << idx << ": " << job.binary << ": " << status;
+    if (job.loaded)
+      std::cerr << ", " << job.cycles << " cycles, "
+                << (job.cycles / job.seconds) << " Hz";
+    std::cerr << "\n";
+  }
+  std::cerr << total_cycles << " cycles total across " << jobs.size()
+            << " instances on " << num_workers << " workers\n";
+  std::cerr << "aggregate: " << (total_cycles / wall_seconds) << " Hz\n";
+  return num_failed > 0 ? 1 : 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Fork Mode
+//===----------------------------------------------------------------------===//
+
+/// Result of a binary simulated in a forked child. Sent to the parent over a
+/// pipe, followed by `output_size` bytes of console output.
+struct ForkRecord {
+  static constexpr unsigned MAX_MODELS = 2;
+  bool loaded = false;
+  RunResult result;
+  size_t cycles = 0;
+  double seconds[MAX_MODELS] = {};
+  size_t output_size = 0;
+};
+
+static void write_all(int fd, const void *data, size_t size) {
+  auto *ptr = static_cast<const char *>(data);
+  while (size > 0) {
+    auto written = write(fd, ptr, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    ptr += written;
+    size -= written;
+  }
+}
+
+/// Simulate a binary on the inherited, already reset model and report the
+/// outcome to the parent through `fd`.
+static void run_child(ComparingRocketModel &model, const char *binary,
+                      const RunOptions &options, int fd) {
+  std::ostringstream output;
+  Memory memory;
+  HostInterface host;
+  ForkRecord record;
+  model.cycle = 0;
+  for (auto &m : model.models)
+    m->duration = std::chrono::high_resolution_clock::duration::zero();
+  record.loaded = load_binary(binary, memory, host, output);
+  if (record.loaded) {
+    record.result =
+        run_binary(model, memory, host, options, output, output);
+    print_hart_stats(record.result, output);
+    record.cycles = model.cycle;
+    for (unsigned i = 0; i < model.models.size(); ++i)
+      record.seconds[i] =
+          std::chrono::duration_cast<std::chrono::duration<double>>(
+              model.models[i]->duration)
+              .count();
+  }
+  auto text = output.str();
+  record.output_size = text.size();
+  write_all(fd, &record, sizeof(record));
+  write_all(fd, text.data(), text.size());
+}
+
+/// Fork one child per binary from the reset model, with at most
+/// `max_children` running at the same time. The children share the model
+/// state with the parent copy-on-write and send their results back through a
+/// pipe.
+static int run_forked(ComparingRocketModel &model,
+                      const std::vector<const char *> &binaries,
+                      unsigned max_children, const RunOptions &options) {
+  struct Child {
+    pid_t pid;
+    int fd;
+    size_t job;
+  };
+  std::vector<Child> running;
+  std::vector<std::string> data(binaries.size());
+  std::vector<int> statuses(binaries.size(), 0);
+  size_t next_job = 0;
+
+  // Make sure buffered output does not get duplicated into the children.
+  std::cout.flush();
+  std::cerr.flush();
+
+  while (next_job < binaries.size() || !running.empty()) {
+    // Spawn children up to the concurrency limit.
+    while (next_job < binaries.size() && running.size() < max_children) {
+      int fds[2];
+      if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+      }
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        return 1;
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        run_child(model, binaries[next_job], options, fds[1]);
+        close(fds[1]);
+        _exit(0);
+      }
+      close(fds[1]);
+      running.push_back({pid, fds[0], next_job++});
+    }
+
+    // Collect output from the running children.
+    std::vector<pollfd> pfds;
+    for (auto &child : running)
+      pfds.push_back({child.fd, POLLIN, 0});
+    if (poll(pfds.data(), pfds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("poll");
+      return 1;
+    }
+    for (unsigned i = running.size(); i-- > 0;) {
+      if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      auto &child = running[i];
+      char buffer[65536];
+      auto num_read = read(child.fd, buffer, sizeof(buffer));
+      if (num_read < 0 && errno == EINTR)
+        continue;
+      if (num_read > 0) {
+        data[child.job].append(buffer, num_read);
+        continue;
+      }
+      close(child.fd);
+      waitpid(child.pid, &statuses[child.job], 0);
+      running.erase(running.begin() + i);
+    }
+  }
+
+  // Report the results.
+  unsigned num_failed = 0;
+  std::vector<ForkRecord> records(binaries.size());
+  for (unsigned job = 0; job < binaries.size(); ++job) {
+    auto &record = records[job];
+    bool complete = data[job].size() >= sizeof(record);
+    if (complete) {
+      memcpy(&record, data[job].data(), sizeof(record));
+      complete = data[job].size() == sizeof(record) + record.output_size;
+    }
+    std::cout << "----- job " << job << ": " << binaries[job] << " -----\n";
+    if (complete)
+      std::cout << data[job].substr(sizeof(record));
+    else
+      record = ForkRecord();
+    if (!complete || !record.loaded || !record.result.succeeded())
+      ++num_failed;
+  }
+  std::cout << std::flush;
+
+  std::cerr << "----------------------------------------\n";
+  for (unsigned job = 0; job < binaries.size(); ++job) {
+    auto &record = records[job];
+    std::cerr << "job " << job << ": " << binaries[job] << ": ";
+    if (WIFSIGNALED(statuses[job]))
+      std::cerr << "killed by signal " << WTERMSIG(statuses[job]);
+    else if (!record.loaded)
+      std::cerr << "load failed";
+    else if (record.result.mismatch)
+      std::cerr << "port mismatches";
+    else if (!record.result.finished)
+      std::cerr << "timeout";
+    else if (!record.result.succeeded())
+      std::cerr << "failed";
+    else
+      std::cerr << "finished";
+    if (record.loaded) {
+      std::cerr << ", " << record.cycles << " cycles";
+      for (unsigned i = 0; i < model.models.size(); ++i)
+        std::cerr << ", " << model.models[i]->name << ": "
+                  << (record.cycles / record.seconds[i]) << " Hz";
+    }
+    std::cerr << "\n";
+  }
+  return num_failed > 0 ? 1 : 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmark Mode
+//===----------------------------------------------------------------------===//
+
+/// Hardware event counters of the calling thread, read through
+/// `perf_event_open`. Events the host does not support, or that the kernel
+/// does not let us count, are reported as unavailable.
+class HardwareCounters {
+public:
+  enum Event { INSTRUCTIONS, DATA_READS, DATA_WRITES, NUM_EVENTS };
+
+  HardwareCounters() {
+#ifdef __linux__
+    constexpr uint64_t L1D_READ =
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16;
+    constexpr uint64_t L1D_WRITE =
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_WRITE << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16;
+    fds[INSTRUCTIONS] =
+        open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[DATA_READS] = open_event(PERF_TYPE_HW_CACHE, L1D_READ);
+    fds[DATA_WRITES] = open_event(PERF_TYPE_HW_CACHE, L1D_WRITE);
+#endif
+  }
+
+  ~HardwareCounters() {
+    for (int fd : fds)
+      if (fd >= 0)
+        close(fd);
+  }
+
+  HardwareCounters(const HardwareCounters &) = delete;
+  HardwareCounters &operator=(const HardwareCounters &) = delete;
+
+  bool available(Event event) const { return fds[event] >= 0; }
+
+  /// Reset and start all counters.
+  void start() {
+#ifdef __linux__
+    for (int fd : fds) {
+      if (fd < 0)
+        continue;
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /// Stop all counters and latch their values.
+  void stop() {
+#ifdef __linux__
+    for (unsigned i = 0; i < NUM_EVENTS; ++i) {
+      if (fds[i] < 0)
+        continue;
+      ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+        values[i] = 0;
+    }
+#endif
+  }
+
+  uint64_t value(Event event) const { return values[event]; }
+
+private:
+  int fds[NUM_EVENTS] = {-1, -1, -1};
+  uint64_t values[NUM_EVENTS] = {};
+
+#ifdef __linux__
+  static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+#endif
+};
+
+/// Summary statistics of a set of samples.
+struct SampleStats {
+  double mean = 0;
+  double median = 0;
+  double stdev = 0;
+  /// Bounds of the 95% confidence interval of the mean.
+  double ci_low = 0;
+  double ci_high = 0;
+  /// Indices of the samples outside of the Tukey fences, 1.5 interquartile
+  /// ranges beyond the first and third quartile.
+  std::vector<size_t> outliers;
+};
+
+/// Two-sided 95% critical value of Student's t distribution with `df`
+/// degrees of freedom.
+static double t_critical_95(size_t df) {
+  static constexpr double TABLE[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df == 0)
+    return 0;
+  if (df <= sizeof(TABLE) / sizeof(*TABLE))
+    return TABLE[df - 1];
+  return 1.96 + 2.4 / df;
+}
+
+/// Quantile `q` of the sorted `samples`, interpolating linearly between
+/// neighbouring samples.
+static double quantile(const std::vector<double> &sorted, double q) {
+  double pos = q * (sorted.size() - 1);
+  size_t idx = pos;
+  if (idx + 1 >= sorted.size())
+    return sorted.back();
+  return sorted[idx] + (pos - idx) * (sorted[idx + 1] - sorted[idx]);
+}
+
+static SampleStats compute_stats(const std::vector<double> &samples) {
+  SampleStats stats;
+  size_t n = samples.size();
+  if (n == 0)
+    return stats;
+  for (double x : samples)
+    stats.mean += x;
+  stats.mean /= n;
+  if (n > 1) {
+    double sum_sq = 0;
+    for (double x : samples)
+      sum_sq += (x - stats.mean) * (x - stats.mean);
+    stats.stdev = std::sqrt(sum_sq / (n - 1));
+  }
+  double margin = t_critical_95(n - 1) * stats.stdev / std::sqrt(double(n));
+  stats.ci_low = stats.mean - margin;
+  stats.ci_high = stats.mean + margin;
+
+  auto sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+  stats.median = quantile(sorted, 0.5);
+  double q1 = quantile(sorted, 0.25);
+  double q3 = quantile(sorted, 0.75);
+  double fence_low = q1 - 1.5 * (q3 - q1);
+  double fence_high = q3 + 1.5 * (q3 - q1);
+  for (size_t i = 0; i < n; ++i)
+    if (samples[i] < fence_low || samples[i] > fence_high)
+      stats.outliers.push_back(i);
+  return stats;
+}
+
+static void write_json_string(std::ostream &os, std::string_view str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (c == '\n')
+      os << "\\n";
+    else
+      os << c;
+  }
+  os << '"';
+}
+
+struct BenchOptions {
+  /// Number of unmeasured runs before the measured ones.
+  unsigned warmup = 3;
+  /// Number of measured runs.
+  unsigned reps = 10;
+  /// Measure the Verilator instead of the Arcilator model.
+  bool vtor = false;
+  /// Additional key-value pairs to add to the JSON output.
+  std::vector<std::pair<std::string, std::string>> metadata;
+};
+
+/// Simulate the binary repeatedly on a fresh model and print statistics of
+/// the simulation frequency as JSON to stdout. The instruction and data access
+/// counts are the median across the measured runs, taken from the hardware
+/// counters of the host while the simulation loop runs. The fields match the
+/// output of `benchmark.py`, such that the results can be compared directly.
+static int run_bench(const char *binary, const BenchOptions &bench,
+                     const RunOptions &options) {
+  HardwareCounters counters;
+  std::vector<double> freqs;
+  std::vector<uint64_t> counts[HardwareCounters::NUM_EVENTS];
+  size_t cycles = 0;
+
+  for (unsigned rep = 0; rep < bench.warmup + bench.reps; ++rep) {
+    std::ostringstream output;
+    Memory memory;
+    HostInterface host;
+    if (!load_binary(binary, memory, host, output)) {
+      std::cerr << output.str();
+      return 1;
+    }
+    ComparingRocketModel model;
+    model.quiet = true;
+#ifdef ARC_JIT
+    model.models.push_back(makeArcilatorModel());
+#else
+    model.models.push_back(bench.vtor ? makeVerilatorModel()
+                                      : makeArcilatorModel());
+#endif
+    reset_model(model);
+    model.cycle = 0;
+    model.models[0]->duration =
+        std::chrono::high_resolution_clock::duration::zero();
+
+    counters.start();
+    auto result = run_binary(model, memory, host, options, output, output);
+    counters.stop();
+    if (!result.succeeded()) {
+      std::cerr << output.str();
+      print_hart_stats(result, std::cerr);
+      std::cerr << "run " << rep << " of " << binary << " failed\n";
+      return 1;
+    }
+
+    auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                       model.models[0]->duration)
+                       .count();
+    if (rep < bench.warmup)
+      std::cerr << "warmup " << rep;
+    else
+      std::cerr << "run " << (rep - bench.warmup);
+    std::cerr << ": " << model.cycle << " cycles, " << (model.cycle / seconds)
+              << " Hz\n";
+    if (rep < bench.warmup)
+      continue;
+    cycles = model.cycle;
+    freqs.push_back(model.cycle / seconds);
+    for (unsigned i = 0; i < HardwareCounters::NUM_EVENTS; ++i)
+      counts[i].push_back(counters.value(HardwareCounters::Event(i)));
+  }
+
+  auto median_count = [&](HardwareCounters::Event event) {
+    auto sorted = counts[event];
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+  };
+
+  auto stats = compute_stats(freqs);
+  std::ostringstream json;
+  json << std::setprecision(10);
+  json << "{\"freq\": " << stats.median;
+  json << ", \"freq_mean\": " << stats.mean;
+  json << ", \"freq_stdev\": " << stats.stdev;
+  json << ", \"freq_ci95\": [" << stats.ci_low << ", " << stats.ci_high << "]";
+  json << ", \"freq_samples\": [";
+  for (size_t i = 0; i < freqs.size(); ++i)
+    json << (i ? ", " : "") << freqs[i];
+  json << "], \"freq_outliers\": [";
+  for (size_t i = 0; i < stats.outliers.size(); ++i)
+    json << (i ? ", " : "") << stats.outliers[i];
+  json << "], \"cycles\": " << cycles;
+  if (counters.available(HardwareCounters::INSTRUCTIONS))
+    json << ", \"exec_inst\": " << median_count(HardwareCounters::INSTRUCTIONS);
+  if (counters.available(HardwareCounters::DATA_READS) &&
+      counters.available(HardwareCounters::DATA_WRITES)) {
+    auto reads = median_count(HardwareCounters::DATA_READS);
+    auto writes = median_count(HardwareCounters::DATA_WRITES);
+    json << ", \"data_reads\": " << reads;
+    json << ", \"data_writes\": " << writes;
+    json << ", \"data_accesses\": " << (reads + writes);
+  }
+  for (auto &[key, value] : bench.metadata) {
+    json << ", ";
+    write_json_string(json, key);
+    json << ": ";
+    write_json_string(json, value);
+  }
+  json << "}";
+  std::cout << json.str() << std::endl;
+
+  if (!counters.available(HardwareCounters::INSTRUCTIONS) ||
+      !counters.available(HardwareCounters::DATA_READS) ||
+      !counters.available(HardwareCounters::DATA_WRITES))
+    std::cerr << "some hardware counters are unavailable, omitting them from "
+                 "the output\n";
+  if (!stats.outliers.empty())
+    std::cerr << stats.outliers.size() << " of " << freqs.size()
+              << " runs are outliers\n";
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Main
+//===----------------------------------------------------------------------===//
+
+int main(int argc, char **argv) {
+  //===--------------------------------------------------------------------===//
+  // Process CLI arguments
+  //===--------------------------------------------------------------------===//
+
+#ifdef ARC_JIT
+  // The JIT testbench only has the arcilator model.
+  bool optRunAll = false;
+  bool optRunArcs = true;
+#else
+  bool optRunAll = true;
+  bool optRunArcs = false;
+#endif
+  bool optRunVtor = false;
+  char *optVcdOutputFile = nullptr;
+  bool optBatch = false;
+  bool optFork = false;
+  unsigned optJobs = 0;
+  unsigned optRepeat = 1;
+  bool optBench = false;
+  BenchOptions benchOptions;
+#ifdef STATE_FILE
+  const char *optStateFile = STATE_FILE;
+#else
+  const char *optStateFile = nullptr;
+#endif
+  std::vector<std::string> optPeeks;
+  size_t optCompareHash = 0;
+  unsigned optCompareGroups = ~0u;
+  bool optCompareOutputs = false;
+#ifdef ARC_JIT
+  const char *optJitModel = nullptr;
+  std::string optJitCache;
+  bool optJitVerbose = false;
+  if (auto *dir = getenv("XDG_CACHE_HOME"))
+    optJitCache = std::string(dir) + "/arc-jit";
+  else if (auto *dir = getenv("HOME"))
+    optJitCache = std::string(dir) + "/.cache/arc-jit";
+#endif
+  RunOptions options;
+
+  char **argOut = argv + 1;
+  for (char **arg = argv + 1, **argEnd = argv + argc; arg != argEnd; ++arg) {
+    if (strcmp(*arg, "--arcs") == 0) {
+      optRunAll = false;
+      optRunArcs = true;
+      continue;
+    }
+    if (strcmp(*arg, "--vtor") == 0) {
+#ifdef ARC_JIT
+      std::cerr << "`--vtor` is not available in the JIT testbench, which "
+                   "has no verilator model\n";
+      return 1;
+#endif
+      optRunAll = false;
+      optRunVtor = true;
+      continue;
+    }
+    if (strcmp(*arg, "--trace") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing trace output file name after `--trace`\n";
+        return 1;
+      }
+      optVcdOutputFile = *arg;
+      continue;
+    }
+    if (strcmp(*arg, "--jobs") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of workers after `--jobs`\n";
+        return 1;
+      }
+      optBatch = !optFork;
+      optJobs = atoi(*arg);
+      continue;
+    }
+    if (strcmp(*arg, "--fork") == 0) {
+      optBatch = false;
+      optFork = true;
+      continue;
+    }
+    if (strcmp(*arg, "--repeat") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing repetition count after `--repeat`\n";
+        return 1;
+      }
+      optRepeat = std::max(atoi(*arg), 1);
+      continue;
+    }
+    if (strcmp(*arg, "--bench") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing repetition count after `--bench`\n";
+        return 1;
+      }
+      optBench = true;
+      benchOptions.reps = std::max(atoi(*arg), 1);
+      continue;
+    }
+    if (strcmp(*arg, "--bench-warmup") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing repetition count after `--bench-warmup`\n";
+        return 1;
+      }
+      benchOptions.warmup = std::max(atoi(*arg), 0);
+      continue;
+    }
+    if (strcmp(*arg, "--metadata") == 0) {
+      ++arg;
+      const char *eq = arg != argEnd ? strchr(*arg, '=') : nullptr;
+      if (!eq) {
+        std::cerr << "missing `<KEY>=<VALUE>` after `--metadata`\n";
+        return 1;
+      }
+      benchOptions.metadata.emplace_back(std::string(*arg, eq - *arg), eq + 1);
+      continue;
+    }
+    if (strcmp(*arg, "--state-file") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing JSON file name after `--state-file`\n";
+        return 1;
+      }
+      optStateFile = *arg;
+      continue;
+    }
+    if (strcmp(*arg, "--peek") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing state name after `--peek`\n";
+        return 1;
+      }
+      optPeeks.push_back(*arg);
+      continue;
+    }
+    if (strcmp(*arg, "--stats") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing sampling interval after `--stats`\n";
+        return 1;
+      }
+      options.stats_interval = strtoull(*arg, nullptr, 0);
+      continue;
+    }
+    if (strcmp(*arg, "--compare-hash") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of cycles after `--compare-hash`\n";
+        return 1;
+      }
+      optCompareHash = strtoull(*arg, nullptr, 0);
+      continue;
+    }
+    if (strcmp(*arg, "--compare-outputs") == 0) {
+      optCompareOutputs = true;
+      continue;
+    }
+    if (strcmp(*arg, "--compare-groups") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing port groups after `--compare-groups`\n";
+        return 1;
+      }
+      optCompareGroups = 0;
+      std::stringstream groups(*arg);
+      std::string group;
+      while (std::getline(groups, group, ',')) {
+        unsigned idx = 0;
+        while (idx < PortInfo::NUM_GROUPS &&
+               group != PortInfo::GROUP_NAMES[idx])
+          ++idx;
+        if (idx == PortInfo::NUM_GROUPS) {
+          std::cerr << "unknown port group `" << group
+                    << "` in `--compare-groups`\n";
+          return 1;
+        }
+        optCompareGroups |= 1u << idx;
+      }
+      continue;
+    }
+    if (strcmp(*arg, "--idle-skip") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of cycles after `--idle-skip`\n";
+        return 1;
+      }
+      options.idle_cycles = strtoull(*arg, nullptr, 0);
+      continue;
+    }
+    if (strcmp(*arg, "--max-cycles") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of cycles after `--max-cycles`\n";
+        return 1;
+      }
+      options.max_cycles = strtoull(*arg, nullptr, 0);
+      continue;
+    }
+    if (strcmp(*arg, "--instret-counter") == 0 ||
+        strcmp(*arg, "--cycle-counter") == 0) {
+      auto &counter = (*arg)[2] == 'i' ? options.instret_counter
+                                        : options.cycle_counter;
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing state name after `" << arg[-1] << "`\n";
+        return 1;
+      }
+      counter = *arg;
+      continue;
+    }
+    if (strcmp(*arg, "--axi-outstanding") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of bursts after `--axi-outstanding`\n";
+        return 1;
+      }
+      options.axi_outstanding = atoi(*arg);
+      if (options.axi_outstanding < 1) {
+        std::cerr << "number of outstanding bursts must be at least 1\n";
+        return 1;
+      }
+      continue;
+    }
+    if (strcmp(*arg, "--axi-interleave") == 0) {
+      options.axi_interleave = true;
+      continue;
+    }
+    if (strcmp(*arg, "--mem-timing") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing timing model after `--mem-timing`\n";
+        return 1;
+      }
+      if (strcmp(*arg, "ideal") == 0) {
+        options.mem_timing = RunOptions::MEM_IDEAL;
+      } else if (strcmp(*arg, "banked") == 0) {
+        options.mem_timing = RunOptions::MEM_BANKED;
+      } else if (strncmp(*arg, "fixed", 5) == 0 &&
+                 ((*arg)[5] == 0 || (*arg)[5] == ':')) {
+        options.mem_timing = RunOptions::MEM_FIXED;
+        if ((*arg)[5] == ':')
+          options.mem_latency = atoi(*arg + 6);
+        if (options.mem_latency < 1) {
+          std::cerr << "memory latency must be at least 1 cycle\n";
+          return 1;
+        }
+      } else {
+        std::cerr << "unknown memory timing model `" << *arg
+                  << "`; expected `ideal`, `fixed[:<N>]`, or `banked`\n";
+        return 1;
+      }
+      continue;
+    }
+#ifdef ARC_JIT
+    if (strcmp(*arg, "--jit") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing model file name after `--jit`\n";
+        return 1;
+      }
+      optJitModel = *arg;
+      continue;
+    }
+    if (strcmp(*arg, "--jit-cache") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing directory after `--jit-cache`\n";
+        return 1;
+      }
+      optJitCache = *arg;
+      continue;
+    }
+    if (strcmp(*arg, "--jit-verbose") == 0) {
+      optJitVerbose = true;
+      continue;
+    }
+#endif
+    if (strcmp(*arg, "--harts") == 0) {
+      ++arg;
+      if (arg == argEnd) {
+        std::cerr << "missing number of harts after `--harts`\n";
+        return 1;
+      }
+      options.num_harts = atoi(*arg);
+      if (options.num_harts < 1 || options.num_harts > MAX_HARTS) {
+        std::cerr << "number of harts must be between 1 and " << MAX_HARTS
+                  << "\n";
+        return 1;
+      }
+      continue;
+    }
+    *argOut++ = *arg;
+  }
+  argc = argOut - argv;
+
+  if (argc < 2 || (argc > 2 && !optBatch && !optFork)) {
+    std::cerr << "usage: " << argv[0] << " [options] <binary>...\n";
+    std::cerr << "options:\n";
+    std::cerr << "  --arcs         run arcilator simulation\n";
+    std::cerr << "  --vtor         run verilator simulation\n";
+    std::cerr << "  --trace <VCD>  write trace to <VCD> file\n";
+    std::cerr << "  --jobs <N>     simulate all binaries on independent "
+                 "arcilator models\n";
+    std::cerr << "                 using N pinned worker threads (0 = all "
+                 "cores)\n";
+    std::cerr << "  --fork         reset the models once and fork one child "
+                 "per binary;\n";
+    std::cerr << "                 `--jobs` limits the number of concurrent "
+                 "children\n";
+    std::cerr << "  --repeat <N>   run each binary N times in batch or fork "
+                 "mode\n";
+    std::cerr << "  --bench <N>    simulate the binary N times on a fresh "
+                 "model and print\n";
+    std::cerr << "                 frequency statistics and hardware counters "
+                 "as JSON\n";
+    std::cerr << "  --bench-warmup <N>\n";
+    std::cerr << "                 unmeasured runs before `--bench` (default "
+                 "3)\n";
+    std::cerr << "  --metadata <KEY>=<VALUE>\n";
+    std::cerr << "                 additional field for the `--bench` JSON "
+                 "output\n";
+    std::cerr << "  --harts <N>    wait for N harts to exit (default 1)\n";
+    std::cerr << "  --max-cycles <N>\n";
+    std::cerr << "                 give up after N cycles (default "
+              << MAX_CYCLES << ")\n";
+    std::cerr << "  --state-file <JSON>\n";
+    std::cerr << "                 arcilator state file describing the model "
+                 "storage\n";
+    std::cerr << "  --peek <STATE> print an arcilator model state after the "
+                 "run;\n";
+    std::cerr << "                 use `<STATE>[<N>]` for memory words\n";
+    std::cerr << "  --stats <N>    sample retired instructions and cycles from "
+                 "the\n";
+    std::cerr << "                 arcilator model state every N cycles\n";
+    std::cerr << "  --compare-hash <N>\n";
+    std::cerr << "                 compare rolling hashes of the lockstep "
+                 "model ports, and the\n";
+    std::cerr << "                 ports themselves, only every N cycles\n";
+    std::cerr << "  --compare-outputs\n";
+    std::cerr << "                 compare only the output ports of the "
+                 "lockstep models\n";
+    std::cerr << "  --compare-groups <G>[,<G>...]\n";
+    std::cerr << "                 compare only the ports in the given groups "
+                 "(clock, reset,\n";
+    std::cerr << "                 debug, mem, mmio)\n";
+    std::cerr << "  --idle-skip <N>\n";
+    std::cerr << "                 fast-forward in bursts once the cores have "
+                 "retired nothing\n";
+    std::cerr << "                 and used no AXI port for N cycles\n";
+    std::cerr << "  --instret-counter <LO>[,<HI>]\n";
+    std::cerr << "  --cycle-counter <LO>[,<HI>]\n";
+    std::cerr << "                 state name suffixes of the counters to "
+                 "sample\n";
+    std::cerr << "  --axi-outstanding <N>\n";
+    std::cerr << "                 accept up to N read and N write bursts on "
+                 "the memory port\n";
+    std::cerr << "                 (default 1)\n";
+    std::cerr << "  --axi-interleave\n";
+    std::cerr << "                 interleave read data of bursts with "
+                 "different IDs\n";
+    std::cerr << "  --mem-timing <ideal|fixed[:<N>]|banked>\n";
+    std::cerr << "                 answer memory bursts right away, after N "
+                 "cycles (default 20),\n";
+    std::cerr << "                 or from a banked DRAM with row buffers\n";
+#ifdef ARC_JIT
+    std::cerr << "  --jit <MODEL>  compile the arcilator model from LLVM IR "
+                 "or MLIR at startup\n";
+    std::cerr << "                 (required; LLVM IR also needs "
+                 "`--state-file`)\n";
+    std::cerr << "  --jit-cache <DIR>\n";
+    std::cerr << "                 cache compiled models in DIR (default "
+                 "~/.cache/arc-jit)\n";
+    std::cerr << "  --jit-verbose  print what is compiled and loaded, and how "
+                 "long it takes\n";
+#endif
+    return 1;
+  }
+
+#ifdef ARC_JIT
+  // Compile the arcilator model, or load it from the cache. The JIT testbench
+  // is built without the models of a particular config, so there is no
+  // verilator model to run in lockstep.
+  if (!optJitModel) {
+    std::cerr << "missing `--jit <MODEL>`\n";
+    return 1;
+  }
+  std::string jitStateFile = optStateFile ? optStateFile : "";
+  std::string jitError;
+  if (!loadJitModel(optJitModel, jitStateFile, optJitCache, optJitVerbose,
+                    jitError)) {
+    std::cerr << jitError << "\n";
+    return 1;
+  }
+  optStateFile = jitStateFile.c_str();
+#endif
+
+  if (optJobs == 0)
+    optJobs = std::max(std::thread::hardware_concurrency(), 1u);
+  std::vector<const char *> binaries;
+  for (unsigned i = 0; i < optRepeat; ++i)
+    binaries.insert(binaries.end(), argv + 1, argv + argc);
+
+  // Load the state file to look into the arcilator model.
+  StateFile state_file;
+  if (!optPeeks.empty() || options.stats_interval > 0 ||
+      options.idle_cycles > 0) {
+    if (!optStateFile) {
+      std::cerr << "`--peek`, `--stats`, and `--idle-skip` require a "
+                   "`--state-file`\n";
+      return 1;
+    }
+    if (!state_file.load(optStateFile)) {
+      std::cerr << state_file.error << "\n";
+      return 1;
+    }
+    options.state_file = &state_file;
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Batch mode
+  //===--------------------------------------------------------------------===//
+
+  if (optBatch) {
+    if (optRunVtor || optVcdOutputFile) {
+      std::cerr << "`--jobs` only supports arcilator models without tracing\n";
+      return 1;
+    }
+    return run_batch(binaries, optJobs, options);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Benchmark mode
+  //===--------------------------------------------------------------------===//
+
+  if (optBench) {
+    if (optRunArcs && optRunVtor) {
+      std::cerr << "`--bench` measures either the arcilator or the verilator "
+                   "model\n";
+      return 1;
+    }
+    if (optFork || optVcdOutputFile) {
+      std::cerr << "`--bench` does not support `--fork` or tracing\n";
+      return 1;
+    }
+    benchOptions.vtor = optRunVtor;
+    return run_bench(argv[1], benchOptions, options);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Read ELF into memory
+  //===--------------------------------------------------------------------===//
+
+  Memory memory;
+  HostInterface host;
+  if (!optFork && !load_binary(argv[1], memory, host, std::cerr))
+    return 1;
+
+  // Allocate the simulation models.
+  ComparingRocketModel model;
+#ifndef ARC_JIT
+  if (optRunAll || optRunVtor)
+    model.models.push_back(makeVerilatorModel());
+#endif
+  if (optRunAll || optRunArcs)
+    model.models.push_back(makeArcilatorModel());
+  model.hash_interval = optCompareHash;
+  model.select_ports(optCompareGroups, optCompareOutputs);
+  if (!optPeeks.empty() && !model.get_storage()) {
+    model.quiet = true;
+    std::cerr << "`--peek` requires an arcilator model\n";
+    return 1;
+  }
+
+  if (optVcdOutputFile) {
+    if (optFork) {
+      std::cerr << "`--fork` does not support tracing\n";
+      return 1;
+    }
+    model.vcd_start(optVcdOutputFile);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Model initialization and reset
+  //===--------------------------------------------------------------------===//
+
+  reset_model(model);
+
+  if (optFork) {
+    model.quiet = true;
+    return run_forked(model, binaries, optJobs, options);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Simulation loop
+  //===--------------------------------------------------------------------===//
+
+  auto result =
+      run_binary(model, memory, host, options, std::cout, std::cerr);
+  if (result.mismatch) {
+    std::cerr << "aborting due to port mismatches\n";
+    return 1;
+  }
+  print_hart_stats(result, std::cerr);
+  for (auto &peek : optPeeks)
+    print_state(state_file, model.get_storage(), peek, std::cerr);
+  if (result.finished && !result.succeeded())
+    return 1;
   return 0;
 }
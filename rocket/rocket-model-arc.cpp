@@ -27,9 +27,11 @@ public:
 
   void eval() override { RocketSystem_eval(&model.storage[0]); }
 
+  uint8_t *get_storage() override { return &model.storage[0]; }
+
   Ports get_ports() override {
     return {
-#define PORT(name) model.view.name,
+#define PORT(name, ...) model.view.name,
 #include "ports.def"
     };
   }
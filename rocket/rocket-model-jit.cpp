@@ -0,0 +1,226 @@
+#include "arc-jit.h"
+#include "arc-state.h"
+#include "rocket-model.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Arcilator model compiled at runtime through the LLVM ORC JIT. The ports are
+// bound through the state file instead of the header generated by
+// `arcilator-header-cpp.py`, such that one testbench runs any config of the
+// design without being rebuilt.
+
+namespace {
+/// Unsigned integer type in which arcilator stores a state of `Width` bits.
+template <unsigned Width>
+using PortType = std::conditional_t<
+    Width <= 8, uint8_t,
+    std::conditional_t<Width <= 16, uint16_t,
+                       std::conditional_t<Width <= 32, uint32_t, uint64_t>>>;
+
+/// Bytes arcilator stores a state of `num_bits` in, as in `PortType`.
+constexpr unsigned port_bytes(unsigned num_bits) {
+  return num_bits <= 8 ? 1 : num_bits <= 16 ? 2 : num_bits <= 32 ? 4 : 8;
+}
+
+/// A port of the model of `Width` bits, located through the state file once
+/// and then accessed directly in the model storage, like the fields of the
+/// header generated by `arcilator-header-cpp.py`. `loadJitModel` checks that
+/// the state file stores the port in a `PortType<Width>`.
+template <unsigned Width>
+class PortRef {
+  PortType<Width> *ptr = nullptr;
+
+public:
+  void bind(uint8_t *storage, const StateInfo *info) {
+    ptr = reinterpret_cast<PortType<Width> *>(storage + info->offset);
+  }
+  operator PortType<Width>() const { return *ptr; }
+  PortRef &operator=(uint64_t value) {
+    *ptr = value;
+    return *this;
+  }
+};
+
+/// Ports of the model, named as in the generated header.
+struct View {
+#define PORT(name, width, ...) PortRef<width> name;
+#include "ports.def"
+  /// Used by `get_mem`, but left out of `ports.def`.
+  PortRef<1> mem_axi4_0_b_ready;
+};
+
+/// Ports of the model that are bound by name, and their width.
+const std::pair<const char *, unsigned> PORT_WIDTHS[] = {
+#define PORT(name, width, ...) {#name, width},
+#include "ports.def"
+    {"mem_axi4_0_b_ready", 1}};
+
+ArcJit jit;
+StateFile state_file;
+void (*eval_fn)(void *) = nullptr;
+void (*initial_fn)(void *) = nullptr;
+
+class JitRocketModel : public RocketModel {
+  struct Model {
+    /// Storage aligned to a cache line, like the arcilator model class.
+    std::unique_ptr<uint8_t, decltype(&std::free)> storage{nullptr, std::free};
+    View view;
+  } model;
+
+public:
+  JitRocketModel() {
+    name = "arcs";
+    size_t num_bytes =
+        std::max<size_t>((state_file.num_state_bytes + 63) / 64 * 64, 64);
+    model.storage.reset(
+        static_cast<uint8_t *>(std::aligned_alloc(64, num_bytes)));
+    std::memset(model.storage.get(), 0, num_bytes);
+#define PORT(name, ...)                                                        \
+  model.view.name.bind(model.storage.get(), state_file.find(#name));
+#include "ports.def"
+    model.view.mem_axi4_0_b_ready.bind(
+        model.storage.get(), state_file.find("mem_axi4_0_b_ready"));
+    if (initial_fn)
+      initial_fn(model.storage.get());
+  }
+
+  void eval() override { eval_fn(model.storage.get()); }
+
+  uint8_t *get_storage() override { return model.storage.get(); }
+
+  Ports get_ports() override {
+    return {
+#define PORT(name, ...) model.view.name,
+#include "ports.def"
+    };
+  }
+
+  void set_reset(bool reset) override { model.view.reset = reset; }
+
+  void set_clock(bool clock) override { model.view.clock = clock; }
+
+  void set_mem(AxiInputs &in) override {
+    model.view.mem_axi4_0_aw_ready = in.aw_ready;
+    model.view.mem_axi4_0_w_ready = in.w_ready;
+    model.view.mem_axi4_0_b_valid = in.b_valid;
+    model.view.mem_axi4_0_b_bits_id = in.b_id;
+    model.view.mem_axi4_0_b_bits_resp = in.b_resp;
+    model.view.mem_axi4_0_ar_ready = in.ar_ready;
+    model.view.mem_axi4_0_r_valid = in.r_valid;
+    model.view.mem_axi4_0_r_bits_id = in.r_id;
+    model.view.mem_axi4_0_r_bits_data = in.r_data;
+    model.view.mem_axi4_0_r_bits_resp = in.r_resp;
+    model.view.mem_axi4_0_r_bits_last = in.r_last;
+  }
+
+  AxiOutputs get_mem() override {
+    AxiOutputs out;
+    out.aw_valid = model.view.mem_axi4_0_aw_valid;
+    out.aw_id = model.view.mem_axi4_0_aw_bits_id;
+    out.aw_addr = model.view.mem_axi4_0_aw_bits_addr;
+    out.aw_len = model.view.mem_axi4_0_aw_bits_len;
+    out.aw_size = model.view.mem_axi4_0_aw_bits_size;
+    out.w_valid = model.view.mem_axi4_0_w_valid;
+    out.w_data = model.view.mem_axi4_0_w_bits_data;
+    out.w_strb = model.view.mem_axi4_0_w_bits_strb;
+    out.w_last = model.view.mem_axi4_0_w_bits_last;
+    out.b_ready = model.view.mem_axi4_0_b_ready;
+    out.ar_valid = model.view.mem_axi4_0_ar_valid;
+    out.ar_id = model.view.mem_axi4_0_ar_bits_id;
+    out.ar_addr = model.view.mem_axi4_0_ar_bits_addr;
+    out.ar_len = model.view.mem_axi4_0_ar_bits_len;
+    out.ar_size = model.view.mem_axi4_0_ar_bits_size;
+    out.r_ready = model.view.mem_axi4_0_r_ready;
+    return out;
+  }
+
+  void set_mmio(AxiInputs &in) override {
+    model.view.mmio_axi4_0_aw_ready = in.aw_ready;
+    model.view.mmio_axi4_0_w_ready = in.w_ready;
+    model.view.mmio_axi4_0_b_valid = in.b_valid;
+    model.view.mmio_axi4_0_b_bits_id = in.b_id;
+    model.view.mmio_axi4_0_b_bits_resp = in.b_resp;
+    model.view.mmio_axi4_0_ar_ready = in.ar_ready;
+    model.view.mmio_axi4_0_r_valid = in.r_valid;
+    model.view.mmio_axi4_0_r_bits_id = in.r_id;
+    model.view.mmio_axi4_0_r_bits_data = in.r_data;
+    model.view.mmio_axi4_0_r_bits_resp = in.r_resp;
+    model.view.mmio_axi4_0_r_bits_last = in.r_last;
+  }
+
+  AxiOutputs get_mmio() override {
+    AxiOutputs out;
+    out.aw_valid = model.view.mmio_axi4_0_aw_valid;
+    out.aw_id = model.view.mmio_axi4_0_aw_bits_id;
+    out.aw_addr = model.view.mmio_axi4_0_aw_bits_addr;
+    out.aw_len = model.view.mmio_axi4_0_aw_bits_len;
+    out.aw_size = model.view.mmio_axi4_0_aw_bits_size;
+    out.w_valid = model.view.mmio_axi4_0_w_valid;
+    out.w_data = model.view.mmio_axi4_0_w_bits_data;
+    out.w_strb = model.view.mmio_axi4_0_w_bits_strb;
+    out.w_last = model.view.mmio_axi4_0_w_bits_last;
+    out.b_ready = model.view.mmio_axi4_0_b_ready;
+    out.ar_valid = model.view.mmio_axi4_0_ar_valid;
+    out.ar_id = model.view.mmio_axi4_0_ar_bits_id;
+    out.ar_addr = model.view.mmio_axi4_0_ar_bits_addr;
+    out.ar_len = model.view.mmio_axi4_0_ar_bits_len;
+    out.ar_size = model.view.mmio_axi4_0_ar_bits_size;
+    out.r_ready = model.view.mmio_axi4_0_r_ready;
+    return out;
+  }
+};
+} // namespace
+
+bool loadJitModel(const std::string &path, std::string &state_path,
+                  const std::string &cache_dir, bool verbose,
+                  std::string &error) {
+  jit.cache_dir = cache_dir;
+  jit.verbose = verbose;
+  if (!jit.load(path, state_path)) {
+    error = jit.error;
+    return false;
+  }
+  if (state_path.empty()) {
+    error = "`--jit` with LLVM IR requires a `--state-file`";
+    return false;
+  }
+  if (!state_file.load(state_path)) {
+    error = state_file.error;
+    return false;
+  }
+  for (auto [port, width] : PORT_WIDTHS) {
+    auto *info = state_file.find(port);
+    if (!info) {
+      error = std::string("no port `") + port + "` in " + state_path;
+      return false;
+    }
+    if (port_bytes(info->num_bits) != port_bytes(width)) {
+      error = std::string("port `") + port + "` has " +
+              std::to_string(info->num_bits) + " bits in " + state_path +
+              ", expected " + std::to_string(width);
+      return false;
+    }
+  }
+  eval_fn = reinterpret_cast<void (*)(void *)>(
+      jit.lookup(state_file.model_name + "_eval"));
+  if (!eval_fn) {
+    error = "no function `" + state_file.model_name + "_eval` in " + path;
+    return false;
+  }
+  if (!state_file.initial_fn_sym.empty()) {
+    initial_fn = reinterpret_cast<void (*)(void *)>(
+        jit.lookup(state_file.initial_fn_sym));
+    if (!initial_fn) {
+      error = "no function `" + state_file.initial_fn_sym + "` in " + path;
+      return false;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<RocketModel> makeArcilatorModel() {
+  return std::make_unique<JitRocketModel>();
+}
@@ -33,7 +33,7 @@ public:
 
   Ports get_ports() override {
     return {
-#define PORT(name) model.name,
+#define PORT(name, ...) model.name,
 #include "ports.def"
     };
   }
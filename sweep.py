@@ -0,0 +1,397 @@
+#!/usr/bin/env python3
+
+# Build every Rocket and BOOM config and benchmark it in all simulation modes.
+#
+# Example:
+#   ./sweep.py -j 4 --json sweep.json benchmarks/dhrystone.riscv
+#
+# Configs are built in parallel, at most `--jobs` at a time, through the
+# Makefile of each design. The simulations then run one at a time, such that
+# they do not disturb each other's timing. Prints one row per config with the
+# simulation frequency in each mode, the compile time of each stage, and the
+# size of the compiled models. Picks up the `<model>-build.json` written by
+# `build-stats.py` during the arcilator build, and `<model>-build-split.json`
+# of the split build. With `--flavor`, also builds
+# alternative arcilator models, such as profile-guided, link-time optimized, or
+# split ones, and reports their frequency change over the default build in
+# arcs-only mode. The split build also reports its code generation speedup.
+
+from collections import OrderedDict
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+import argparse
+import gzip
+import json
+import os
+import re
+import struct
+import subprocess
+import sys
+import time
+
+REPO_ROOT = Path(__file__).resolve().parent
+MODELS = ["rocket", "boom"]
+MODES = ["arcs", "vtor", "lockstep"]
+MAILBOX_SIZE = 0x100  # bytes per hart, see benchmarks/common/mailbox.h
+
+# Build stages in order, as make targets relative to the build directory.
+STAGES = OrderedDict([
+    ("firtool", "{model}.mlir"),
+    ("arcilator", "{model}-arc.o"),
+    ("verilator", "{model}-vtor.a"),
+    ("testbench", "{model}-main"),
+])
+
+# Alternative builds of the arcilator model, as make targets relative to the
+# build directory. Each one is benchmarked in arcs-only mode and compared
+# against the default build.
+FLAVORS = OrderedDict([
+    ("pgo", "{model}-main-pgo"),
+    ("lto", "{model}-main-lto"),
+    ("split", "{model}-main-split"),
+])
+
+parser = argparse.ArgumentParser(
+    description="Build and benchmark all design configs")
+parser.add_argument("binaries",
+                    metavar="BINARY",
+                    nargs="*",
+                    help="benchmarks to run (default: benchmarks/*.riscv)")
+parser.add_argument("-j",
+                    "--jobs",
+                    type=int,
+                    default=max(1, (os.cpu_count() or 4) // 4),
+                    help="number of configs to build at the same time")
+parser.add_argument("-c",
+                    "--config",
+                    metavar="REGEX",
+                    action="append",
+                    default=[],
+                    help="only sweep configs matching a regex, e.g. "
+                    "'rocket-.*-v1.6'")
+parser.add_argument("-m",
+                    "--mode",
+                    choices=MODES,
+                    action="append",
+                    default=[],
+                    help="simulation modes to run (default: all)")
+parser.add_argument("-f",
+                    "--flavor",
+                    choices=list(FLAVORS),
+                    action="append",
+                    default=[],
+                    help="also build and benchmark an alternative arcilator "
+                    "model build")
+parser.add_argument("--reps",
+                    type=int,
+                    default=3,
+                    help="measured runs per benchmark in arcs and vtor modes")
+parser.add_argument("--no-build",
+                    action="store_true",
+                    help="only run configs that are already built")
+parser.add_argument("--cache",
+                    metavar="DIR",
+                    help="reuse model products of unchanged configs from a "
+                    "build cache")
+parser.add_argument("--run-args",
+                    default="",
+                    help="additional arguments for the simulation binaries")
+parser.add_argument("--json",
+                    metavar="FILE",
+                    help="write all results to a JSON file")
+parser.add_argument("-v",
+                    "--verbose",
+                    action="store_true",
+                    help="show output of builds and runs")
+args = parser.parse_args()
+
+modes = args.mode or MODES
+binaries = args.binaries or sorted(
+    str(p) for p in (REPO_ROOT / "benchmarks").glob("*.riscv"))
+if not binaries:
+    print("no benchmark binaries found", file=sys.stderr)
+    sys.exit(1)
+
+
+def count_tiles(fir):
+    """Count the core tiles instantiated in a gzipped FIRRTL file, such as
+    `RocketTile` and `RocketTile_1`, to run the model with one hart each."""
+    with gzip.open(fir, "rt") as f:
+        return max(
+            1,
+            sum(1 for line in f
+                if re.match(r'\s*inst \w+ of \w+Tile(_\d+)?\s', line)))
+
+
+def count_mailboxes(binary):
+    """Count the harts a RISC-V ELF binary provisions a `tohost` mailbox for,
+    from the space between the `tohost` symbol and the end of its section, as
+    the testbench does. Returns 1 if the binary has no such symbol."""
+    data = Path(binary).read_bytes()
+    if data[:4] != b"\x7fELF":
+        return 1
+    is64 = data[4] == 2
+    end = "<" if data[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(end + "Q", data, 0x28)
+        shentsize, shnum = struct.unpack_from(end + "HH", data, 0x3a)
+        shdr, sym, symsize = end + "IIQQQQIIQQ", end + "IBBHQQ", 24
+    else:
+        shoff, = struct.unpack_from(end + "I", data, 0x20)
+        shentsize, shnum = struct.unpack_from(end + "HH", data, 0x2e)
+        shdr, sym, symsize = end + "IIIIIIIIII", end + "IIIBBH", 16
+    sections = [
+        struct.unpack_from(shdr, data, shoff + i * shentsize)
+        for i in range(shnum)
+    ]
+    for _, sh_type, _, _, offset, size, link, _, _, _ in sections:
+        if sh_type != 2:  # SHT_SYMTAB
+            continue
+        strtab = sections[link]
+        for pos in range(offset, offset + size, symsize):
+            fields = struct.unpack_from(sym, data, pos)
+            if is64:
+                name, _, _, shndx, value, _ = fields
+            else:
+                name, value, _, _, _, shndx = fields
+            start = strtab[4] + name
+            if data[start:data.index(b"\0", start)] != b"tohost":
+                continue
+            if shndx == 0 or shndx >= len(sections):
+                return 1
+            addr, secsize = sections[shndx][3], sections[shndx][5]
+            return max(1, (addr + secsize - value + MAILBOX_SIZE - 1) //
+                       MAILBOX_SIZE)
+    return 1
+
+
+# Collect the configs from the FIRRTL files of each design.
+configs = list()
+for model in MODELS:
+    for fir in sorted((REPO_ROOT / model).glob(f"{model}-*.fir.gz")):
+        name = fir.name[:-len(".fir.gz")]
+        if args.config and not any(re.fullmatch(r, name) for r in args.config):
+            continue
+        configs.append(
+            OrderedDict([
+                ("name", name),
+                ("model", model),
+                ("config", name[len(model) + 1:]),
+                ("fir_bytes", fir.stat().st_size),
+                ("harts", count_tiles(fir)),
+            ]))
+
+
+def build_dir(cfg):
+    return REPO_ROOT / cfg["model"] / "build" / cfg["config"]
+
+
+def log(msg):
+    print(msg, file=sys.stderr, flush=True)
+
+
+#===-----------------------------------------------------------------------===#
+# Build
+#===-----------------------------------------------------------------------===#
+
+
+def build(cfg):
+    """Build the stages of one config in order, timing each of them."""
+    cfg["compile_seconds"] = OrderedDict()
+    targets = list(STAGES.items()) + [(f, FLAVORS[f]) for f in args.flavor]
+    for stage, target in targets:
+        target = f"build/{cfg['config']}/" + target.format(model=cfg["model"])
+        t_start = time.monotonic()
+        cmd = ["make", "-C", cfg["model"], f"CONFIG={cfg['config']}", target]
+        if args.cache:
+            cmd.append(f"BUILD_CACHE={os.path.abspath(args.cache)}")
+        proc = subprocess.run(
+            cmd,
+            cwd=REPO_ROOT,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            text=True)
+        cfg["compile_seconds"][stage] = time.monotonic() - t_start
+        if args.verbose:
+            log(proc.stdout)
+        if proc.returncode != 0:
+            cfg["error"] = f"{stage} failed"
+            log(f"{cfg['name']}: {stage} failed")
+            return cfg
+    log(f"{cfg['name']}: built in "
+        f"{sum(cfg['compile_seconds'].values()):.1f} s")
+    return cfg
+
+
+if not args.no_build:
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        list(pool.map(build, configs))
+
+# Record the model sizes.
+for cfg in configs:
+    model = cfg["model"]
+    directory = build_dir(cfg)
+    if not (directory / f"{model}-main").exists():
+        cfg.setdefault("error", "not built")
+        continue
+    for key, name in [("arc_object_bytes", f"{model}-arc.o"),
+                      ("vtor_archive_bytes", f"{model}-vtor.a")]:
+        path = directory / name
+        if path.exists():
+            cfg[key] = path.stat().st_size
+    try:
+        with open(directory / f"{model}.json") as f:
+            cfg["state_bytes"] = json.load(f)[0]["numStateBytes"]
+    except (OSError, ValueError, LookupError):
+        pass
+    for key, name in [("build_stats", f"{model}-build.json"),
+                      ("split_build_stats", f"{model}-build-split.json")]:
+        try:
+            with open(directory / name) as f:
+                cfg[key] = json.load(f)
+        except (OSError, ValueError):
+            pass
+
+#===-----------------------------------------------------------------------===#
+# Simulate
+#===-----------------------------------------------------------------------===#
+
+
+def simulate(cfg, binary, mode, program="{model}-main"):
+    """Run one benchmark and return its simulation frequency in Hz."""
+    cmd = [str(build_dir(cfg) / program.format(model=cfg["model"]))]
+    # Only wait for the harts the binary has a mailbox for.
+    harts = min(cfg["harts"], count_mailboxes(binary))
+    if harts > 1:
+        cmd += ["--harts", str(harts)]
+    cmd += args.run_args.split()
+    if mode == "lockstep":
+        proc = subprocess.run(cmd + [binary],
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              text=True)
+        if args.verbose:
+            log(proc.stdout)
+        if proc.returncode != 0:
+            return None
+        # Both models advance by the same cycles, so the lockstep frequency
+        # combines the time spent in either of them.
+        freqs = [float(m) for m in re.findall(r'(\d+(?:\.\d+)?(?:e[+-]?\d+)?) Hz',
+                                              proc.stdout)]
+        if not freqs or 0 in freqs:
+            return None
+        return 1 / sum(1 / f for f in freqs)
+    proc = subprocess.run(cmd + [
+        f"--{mode}", "--bench",
+        str(args.reps), "--bench-warmup", "1", binary
+    ],
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE,
+                          text=True)
+    if args.verbose:
+        log(proc.stderr)
+    if proc.returncode != 0:
+        return None
+    return json.loads(proc.stdout.strip().splitlines()[-1])["freq"]
+
+
+for cfg in configs:
+    if "error" in cfg:
+        continue
+    cfg["freq"] = OrderedDict()
+    for mode in modes:
+        freqs = OrderedDict()
+        for binary in binaries:
+            freqs[Path(binary).name] = simulate(cfg, binary, mode)
+            log(f"{cfg['name']} {mode} {Path(binary).name}: "
+                f"{freqs[Path(binary).name] or 'failed'}")
+        cfg["freq"][mode] = freqs
+    for flavor in args.flavor:
+        freqs = OrderedDict()
+        for binary in binaries:
+            freqs[Path(binary).name] = simulate(cfg, binary, "arcs",
+                                                FLAVORS[flavor])
+            log(f"{cfg['name']} arcs-{flavor} {Path(binary).name}: "
+                f"{freqs[Path(binary).name] or 'failed'}")
+        cfg["freq"][f"arcs-{flavor}"] = freqs
+
+#===-----------------------------------------------------------------------===#
+# Report
+#===-----------------------------------------------------------------------===#
+
+
+def geomean(values):
+    values = [v for v in values if v]
+    if not values:
+        return None
+    product = 1.0
+    for v in values:
+        product *= v
+    return product**(1 / len(values))
+
+
+def fmt(value, spec):
+    return "-" if value is None else format(value, spec)
+
+
+# Sort by design size, such that the table shows the scaling of simulation
+# speed against it.
+configs.sort(key=lambda c: (c.get("state_bytes") or 0, c["fir_bytes"]))
+
+columns = ["config", "state KB"] + [f"{m} kHz" for m in modes]
+for flavor in args.flavor:
+    columns += [f"{flavor} kHz", f"{flavor} %"]
+if "split" in args.flavor:
+    columns += ["split speedup"]
+columns += [
+    f"{s} s" for s in STAGES
+] + ["arc.o KB", "eval KB", "vtor.a KB", "peak RSS MB"]
+rows = list()
+for cfg in configs:
+    row = [cfg["name"], fmt((cfg.get("state_bytes") or 0) / 1024 or None, ".0f")]
+    for mode in modes:
+        freq = geomean(cfg.get("freq", {}).get(mode, {}).values())
+        row.append(fmt(freq and freq / 1000, ".1f"))
+    # Report each flavor relative to the default arcs-only build.
+    base = geomean(cfg.get("freq", {}).get("arcs", {}).values())
+    for flavor in args.flavor:
+        freq = geomean(cfg.get("freq", {}).get(f"arcs-{flavor}", {}).values())
+        row.append(fmt(freq and freq / 1000, ".1f"))
+        row.append(fmt(freq and base and (freq / base - 1) * 100, "+.1f"))
+    if "split" in args.flavor:
+        stages = cfg.get("build_stats", {}).get("stages", {})
+        serial = sum(stages.get(s, {}).get("wall_seconds", 0)
+                     for s in ["opt", "llc"])
+        stages = cfg.get("split_build_stats", {}).get("stages", {})
+        split = sum(stages.get(s, {}).get("wall_seconds", 0)
+                    for s in ["llvm-split", "split-codegen"])
+        row.append(fmt(serial / split if serial and split else None, ".2f"))
+    for stage in STAGES:
+        row.append(fmt(cfg.get("compile_seconds", {}).get(stage), ".1f"))
+    stats = cfg.get("build_stats", {})
+    evals = stats.get("eval_functions")
+    row.append(fmt(cfg["arc_object_bytes"] /
+                   1024 if "arc_object_bytes" in cfg else None, ".0f"))
+    row.append(fmt(sum(evals.values()) / 1024 if evals else None, ".0f"))
+    row.append(fmt(cfg["vtor_archive_bytes"] /
+                   1024 if "vtor_archive_bytes" in cfg else None, ".0f"))
+    row.append(fmt(stats.get("max_rss_bytes", 0) / 2**20 or None, ".0f"))
+    if "error" in cfg:
+        row[0] += f" ({cfg['error']})"
+    rows.append(row)
+
+widths = [max(len(r[i]) for r in rows + [columns]) for i in range(len(columns))]
+print("  ".join(c.rjust(w) if i else c.ljust(w)
+                for i, (c, w) in enumerate(zip(columns, widths))))
+for row in rows:
+    print("  ".join(c.rjust(w) if i else c.ljust(w)
+                    for i, (c, w) in enumerate(zip(row, widths))))
+if len(binaries) > 1:
+    print(f"(frequencies are the geometric mean across {len(binaries)} "
+          f"benchmarks)")
+
+if args.json:
+    with open(args.json, "w") as f:
+        json.dump(configs, f, indent=2)
+
+sys.exit(1 if any("error" in c for c in configs) else 0)